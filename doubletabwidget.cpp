@@ -31,14 +31,18 @@
 #include "ui_doubletabwidget.h"
 
 #include "stylehelper.h"
+#include "extensions/pixelratio_p.h"
+#include "extensions/tablayout_p.h"
+#include "extensions/taboverflowpopup.h"
 
+#include <QAbstractItemModel>
 #include <QRect>
 #include <QPainter>
 #include <QFont>
 #include <QMouseEvent>
-#include <QMenu>
 #include <QStyleOption>
 #include <QToolTip>
+#include <QtAlgorithms>
 
 #include <QDebug>
 
@@ -91,8 +95,17 @@ DoubleTabWidget::DoubleTabWidget(QWidget *parent) :
     m_mid(QLatin1String(":/projectexplorer/images/midselection.png")),
     m_right(QLatin1String(":/projectexplorer/images/rightselection.png")),
     ui(new Ui::DoubleTabWidget),
+    m_model(0),
     m_currentIndex(-1),
-    m_lastVisibleIndex(-1)
+    m_lastVisibleIndex(-1),
+    m_layoutDirty(true),
+    m_tabWidthsDirty(true),
+    m_tabsLeft(0),
+    m_visibleCount(0),
+    m_currentPinned(false),
+    m_overflowPopup(0),
+    m_chromeDevicePixelRatio(1),
+    m_chromeBaseColor(0)
 {
     ui->setupUi(this);
 }
@@ -113,8 +126,8 @@ void DoubleTabWidget::setCurrentIndex(int index)
     if (index == m_currentIndex)
         return;
     m_currentIndex = index;
+    invalidateLayout();
     emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
-    update();
 }
 
 int DoubleTabWidget::currentSubIndex() const
@@ -127,7 +140,7 @@ int DoubleTabWidget::currentSubIndex() const
 void DoubleTabWidget::setTitle(const QString &title)
 {
     m_title = title;
-    update();
+    invalidateLayout();
 }
 
 QSize DoubleTabWidget::minimumSizeHint() const
@@ -135,69 +148,78 @@ QSize DoubleTabWidget::minimumSizeHint() const
     return QSize(0, Utils::StyleHelper::navigationWidgetHeight() + OTHER_HEIGHT + 1);
 }
 
-void DoubleTabWidget::updateNameIsUniqueAdd(Tab *tab)
+void DoubleTabWidget::addName(const QString &name)
 {
-    tab->nameIsUnique = true;
-    for (int i=0; i < m_tabs.size(); ++i) {
-        if (m_tabs.at(i).name == tab->name) {
-            m_tabs[i].nameIsUnique = false;
-            tab->nameIsUnique = false;
-            break;
-        }
-    }
+    if (++m_nameCounts[name] == 2)
+        m_dirtyNames.insert(name);
 }
 
-void DoubleTabWidget::updateNameIsUniqueRemove(const Tab &tab)
+void DoubleTabWidget::removeName(const QString &name)
 {
-    if (tab.nameIsUnique)
+    QHash<QString, int>::iterator it = m_nameCounts.find(name);
+    if (it == m_nameCounts.end())
         return;
-    int index;
-    int count = 0;
-    for (int i=0; i < m_tabs.size(); ++i) {
-        if (m_tabs.at(i).name == tab.name) {
-            ++count;
-            index = i;
-        }
-    }
-
-    if (count == 1)
-        m_tabs[index].nameIsUnique = true;
+    if (--it.value() == 0)
+        m_nameCounts.erase(it);
+    else if (it.value() == 1)
+        m_dirtyNames.insert(name);
 }
 
-void DoubleTabWidget::addTab(const QString &name, const QString &fullName, const QStringList &subTabs)
+void DoubleTabWidget::insertTabEntry(int index, const QString &name, const QString &fullName, const QStringList &subTabs)
 {
     Tab tab;
     tab.name = name;
     tab.fullName = fullName;
     tab.subTabs = subTabs;
     tab.currentSubTab = tab.subTabs.isEmpty() ? -1 : 0;
-    updateNameIsUniqueAdd(&tab);
 
-    m_tabs.append(tab);
-    update();
+    m_tabs.insert(index, tab);
+    m_nameWidths.insert(index, -1);
+    addName(name);
+    // the display name is set once the tab is measured
+    if (m_overflowPopup)
+        m_overflowPopup->insertTab(index, name);
 }
 
-void DoubleTabWidget::insertTab(int index, const QString &name, const QString &fullName, const QStringList &subTabs)
+void DoubleTabWidget::removeTabEntry(int index)
 {
-    Tab tab;
-    tab.name = name;
-    tab.fullName = fullName;
-    tab.subTabs = subTabs;
-    tab.currentSubTab = tab.subTabs.isEmpty() ? -1 : 0;
-    updateNameIsUniqueAdd(&tab);
+    const QString name = m_tabs.takeAt(index).name;
+    m_nameWidths.remove(index);
+    removeName(name);
+    if (m_overflowPopup)
+        m_overflowPopup->removeTab(index);
+}
 
-    m_tabs.insert(index, tab);
+void DoubleTabWidget::addTab(const QString &name, const QString &fullName, const QStringList &subTabs)
+{
+    insertTabEntry(m_tabs.size(), name, fullName, subTabs);
+    invalidateTabWidths();
+}
+
+void DoubleTabWidget::addTabs(const QStringList &names, const QStringList &fullNames,
+                              const QList<QStringList> &subTabs)
+{
+    Q_ASSERT(names.size() == fullNames.size() && names.size() == subTabs.size());
+    m_tabs.reserve(m_tabs.size() + names.size());
+    for (int i = 0; i < names.size(); ++i)
+        insertTabEntry(m_tabs.size(), names.at(i), fullNames.at(i), subTabs.at(i));
+    invalidateTabWidths();
+}
+
+void DoubleTabWidget::insertTab(int index, const QString &name, const QString &fullName, const QStringList &subTabs)
+{
+    insertTabEntry(index, name, fullName, subTabs);
+    invalidateTabWidths();
     if (m_currentIndex >= index) {
         ++m_currentIndex;
         emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
     }
-    update();
 }
 
 void DoubleTabWidget::removeTab(int index)
 {
-    Tab t = m_tabs.takeAt(index);
-    updateNameIsUniqueRemove(t);
+    removeTabEntry(index);
+    invalidateTabWidths();
     if (index <= m_currentIndex) {
         --m_currentIndex;
         if (m_currentIndex < 0 && m_tabs.size() > 0)
@@ -208,7 +230,6 @@ void DoubleTabWidget::removeTab(int index)
             emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
         }
     }
-    update();
 }
 
 int DoubleTabWidget::tabCount() const
@@ -216,32 +237,298 @@ int DoubleTabWidget::tabCount() const
     return m_tabs.size();
 }
 
+void DoubleTabWidget::setModel(QAbstractItemModel *model)
+{
+    if (model == m_model)
+        return;
+    if (m_model)
+        disconnect(m_model, 0, this, 0);
+    m_model = model;
+    if (m_model) {
+        connect(m_model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                this, SLOT(modelRowsInserted(QModelIndex,int,int)));
+        connect(m_model, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                this, SLOT(modelRowsRemoved(QModelIndex,int,int)));
+        connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                this, SLOT(modelDataChanged(QModelIndex,QModelIndex)));
+        connect(m_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+                this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(layoutChanged()), this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(modelReset()), this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(destroyed()), this, SLOT(modelDestroyed()));
+    }
+    modelReset();
+}
+
+static QStringList subTabsFromModel(const QAbstractItemModel *model, const QModelIndex &parent)
+{
+    QStringList subTabs;
+    const int rowCount = model->rowCount(parent);
+    for (int row = 0; row < rowCount; ++row)
+        subTabs << model->index(row, 0, parent).data().toString();
+    return subTabs;
+}
+
+void DoubleTabWidget::insertTabsFromModel(int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        const QModelIndex index = m_model->index(row, 0);
+        const QString name = index.data().toString();
+        QString fullName = index.data(Qt::ToolTipRole).toString();
+        if (fullName.isEmpty())
+            fullName = name;
+        insertTabEntry(row, name, fullName, subTabsFromModel(m_model, index));
+    }
+    invalidateTabWidths();
+}
+
+void DoubleTabWidget::subTabsChanged(int index, bool currentSubTabChanged)
+{
+    if (index != m_currentIndex)
+        return;
+    invalidateLayout();
+    if (currentSubTabChanged)
+        emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
+}
+
+void DoubleTabWidget::modelRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    const int count = last - first + 1;
+    if (!parent.isValid()) {
+        insertTabsFromModel(first, last);
+        if (m_currentIndex >= first) {
+            m_currentIndex += count;
+            emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
+        }
+        return;
+    }
+    // deeper levels are not shown
+    if (parent.parent().isValid())
+        return;
+
+    Tab &tab = m_tabs[parent.row()];
+    for (int row = first; row <= last; ++row)
+        tab.subTabs.insert(row, m_model->index(row, 0, parent).data().toString());
+    bool currentSubTabChanged = true;
+    if (tab.currentSubTab >= first)
+        tab.currentSubTab += count;
+    else if (tab.currentSubTab == -1)
+        tab.currentSubTab = 0;
+    else
+        currentSubTabChanged = false;
+    subTabsChanged(parent.row(), currentSubTabChanged);
+}
+
+void DoubleTabWidget::modelRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    const int count = last - first + 1;
+    if (!parent.isValid()) {
+        for (int row = last; row >= first; --row)
+            removeTabEntry(row);
+        invalidateTabWidths();
+        if (first <= m_currentIndex) {
+            if (m_currentIndex > last)
+                m_currentIndex -= count;
+            else
+                m_currentIndex = qMax(first - 1, m_tabs.isEmpty() ? -1 : 0);
+            emit currentIndexChanged(m_currentIndex, currentSubIndex());
+        }
+        return;
+    }
+    if (parent.parent().isValid())
+        return;
+
+    Tab &tab = m_tabs[parent.row()];
+    for (int row = last; row >= first; --row)
+        tab.subTabs.removeAt(row);
+    bool currentSubTabChanged = true;
+    if (tab.currentSubTab > last)
+        tab.currentSubTab -= count;
+    else if (tab.currentSubTab >= first)
+        tab.currentSubTab = qMin(first, tab.subTabs.size() - 1);
+    else
+        currentSubTabChanged = false;
+    subTabsChanged(parent.row(), currentSubTabChanged);
+}
+
+void DoubleTabWidget::modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    // only the first column is shown
+    if (topLeft.column() > 0)
+        return;
+
+    const QModelIndex parent = topLeft.parent();
+    if (!parent.isValid()) {
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+            const QModelIndex index = m_model->index(row, 0);
+            const QString name = index.data().toString();
+            QString fullName = index.data(Qt::ToolTipRole).toString();
+            if (fullName.isEmpty())
+                fullName = name;
+            if (name != m_tabs.at(row).name) {
+                removeName(m_tabs.at(row).name);
+                m_tabs[row].name = name;
+                addName(name);
+            }
+            m_tabs[row].fullName = fullName;
+            m_nameWidths[row] = -1;
+        }
+        invalidateTabWidths();
+    } else if (!parent.parent().isValid()) {
+        Tab &tab = m_tabs[parent.row()];
+        for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+            tab.subTabs[row] = m_model->index(row, 0, parent).data().toString();
+        subTabsChanged(parent.row(), false);
+    }
+}
+
+void DoubleTabWidget::modelReset()
+{
+    const int oldIndex = m_currentIndex;
+    const int oldSubIndex = currentSubIndex();
+    m_tabs.clear();
+    m_nameCounts.clear();
+    m_dirtyNames.clear();
+    m_nameWidths.clear();
+    if (m_overflowPopup)
+        m_overflowPopup->setTabNames(QStringList());
+    if (m_model && m_model->rowCount() > 0)
+        insertTabsFromModel(0, m_model->rowCount() - 1);
+    else
+        invalidateTabWidths();
+
+    if (m_currentIndex >= m_tabs.size())
+        m_currentIndex = m_tabs.size() - 1;
+    if (m_currentIndex != oldIndex || currentSubIndex() != oldSubIndex)
+        emit currentIndexChanged(m_currentIndex, currentSubIndex());
+}
+
+void DoubleTabWidget::modelDestroyed()
+{
+    m_model = 0;
+    modelReset();
+}
+
+void DoubleTabWidget::invalidateLayout()
+{
+    m_layoutDirty = true;
+    m_chrome = QPixmap();
+    update();
+}
+
+void DoubleTabWidget::invalidateTabWidths()
+{
+    m_tabWidthsDirty = true;
+    invalidateLayout();
+}
+
+/// Decides which top level tabs are visible. Tabs are shown in order as
+/// long as they fit. If the current tab is not among them, it is pinned
+/// after the last tab that still leaves room for it. The remaining tabs
+/// are reachable through the overflow popup.
+/// Painting and hit testing only read the results of this pass.
+void DoubleTabWidget::ensureLayout()
+{
+    if (!m_layoutDirty)
+        return;
+    m_layoutDirty = false;
+
+    const QFontMetrics fm(font());
+    const int tabCount = m_tabs.size();
+
+    if (m_tabWidthsDirty) {
+        m_tabWidthsDirty = false;
+        // m_tabOffsets[i] is where tab i starts, relative to m_tabsLeft,
+        // when all tabs are shown in order
+        Q_ASSERT(m_nameWidths.size() == tabCount);
+        m_tabOffsets.resize(tabCount + 1);
+        m_tabOffsets[0] = 0;
+        const bool namesDirty = !m_dirtyNames.isEmpty();
+        for (int i = 0; i < tabCount; ++i) {
+            if (namesDirty && m_dirtyNames.contains(m_tabs.at(i).name))
+                m_nameWidths[i] = -1;
+            if (m_nameWidths.at(i) < 0) {
+                const QString name = displayName(m_tabs.at(i));
+                m_nameWidths[i] = fm.width(name);
+                if (m_overflowPopup)
+                    m_overflowPopup->setTabName(i, name);
+            }
+            m_tabOffsets[i + 1] = m_tabOffsets.at(i) + 2 * MARGIN + m_nameWidths.at(i);
+        }
+        m_dirtyNames.clear();
+    }
+
+    m_tabsLeft = m_title.isEmpty() ? 0 :
+            2 * MARGIN + qMax(fm.width(m_title), MIN_LEFT_MARGIN);
+
+    const int availableWidth = width() - m_tabsLeft;
+    m_currentPinned = false;
+    if (m_tabOffsets.at(tabCount) < availableWidth) {
+        // => everything fits
+        m_visibleCount = tabCount;
+    } else {
+        // => we need the overflow thingy
+        const int overflowLeft = availableWidth - OVERFLOW_DROPDOWN_WIDTH;
+        m_visibleCount = fittingTabs(m_tabOffsets, overflowLeft);
+        if (m_currentIndex >= m_visibleCount) {
+            // make room for the current tab
+            m_currentPinned = true;
+            m_visibleCount = fittingTabs(m_tabOffsets, overflowLeft
+                                         - 2 * MARGIN - m_nameWidths.at(m_currentIndex));
+        }
+    }
+    m_lastVisibleIndex = m_visibleCount - (m_currentPinned ? 0 : 1);
+
+    // second level tabs of the current tab
+    m_subTabWidths.clear();
+    if (m_currentIndex != -1) {
+        const QStringList &subTabs = m_tabs.at(m_currentIndex).subTabs;
+        m_subTabWidths.reserve(subTabs.size());
+        foreach (const QString &subTab, subTabs)
+            m_subTabWidths.append(fm.width(subTab));
+    }
+}
+
+/// Returns the index of the tab shown at slot, where slots are
+/// the visible tabs followed by the entries of the overflow popup
+int DoubleTabWidget::tabAtSlot(int slot) const
+{
+    if (!m_currentPinned || slot < m_visibleCount)
+        return slot;
+    if (slot == m_visibleCount)
+        return m_currentIndex;
+    // the pinned current tab is left out of the overflow entries
+    return slot - 1 < m_currentIndex ? slot - 1 : slot;
+}
+
 /// Converts a position to the tab/subtab that is undeneath
 /// If HitArea is tab or subtab, then the second part of the pair
-/// is the tab or subtab number
+/// is the tab slot or subtab number
 QPair<DoubleTabWidget::HitArea, int> DoubleTabWidget::convertPosToTab(QPoint pos)
 {
+    ensureLayout();
     if (pos.y() < Utils::StyleHelper::navigationWidgetHeight()) {
         // on the top level part of the bar
-        int eventX = pos.x();
-        QFontMetrics fm(font());
-        int x = m_title.isEmpty() ? 0 :
-                2 * MARGIN + qMax(fm.width(m_title), MIN_LEFT_MARGIN);
+        int eventX = pos.x() - m_tabsLeft;
 
-        if (eventX <= x)
+        if (eventX <= 0)
             return qMakePair(HITNOTHING, -1);
-        int i;
-        for (i = 0; i <= m_lastVisibleIndex; ++i) {
-            int otherX = x + 2 * MARGIN + fm.width(m_tabs.at(
-                    m_currentTabIndices.at(i)).displayName());
-            if (eventX > x && eventX < otherX) {
-                break;
-            }
+        int x = m_tabOffsets.at(m_visibleCount);
+        if (eventX < x) {
+            // binary search over the tabs shown in order
+            const QVector<int>::const_iterator begin = m_tabOffsets.constBegin();
+            const int slot = qUpperBound(begin, begin + m_visibleCount + 1, eventX) - begin - 1;
+            if (eventX > m_tabOffsets.at(slot))
+                return qMakePair(HITTAB, slot);
+            return qMakePair(HITNOTHING, -1);
+        }
+        if (m_currentPinned) {
+            int otherX = x + 2 * MARGIN + m_nameWidths.at(m_currentIndex);
+            if (eventX > x && eventX < otherX)
+                return qMakePair(HITTAB, m_visibleCount);
             x = otherX;
         }
-        if (i <= m_lastVisibleIndex) {
-            return qMakePair(HITTAB, i);
-        } else if (m_lastVisibleIndex < m_tabs.size() - 1) {
+        if (m_lastVisibleIndex < m_tabs.size() - 1) {
             // handle overflow menu
             if (eventX > x && eventX < x + OVERFLOW_DROPDOWN_WIDTH) {
                 return qMakePair(HITOVERFLOW, -1);
@@ -255,22 +542,19 @@ QPair<DoubleTabWidget::HitArea, int> DoubleTabWidget::convertPosToTab(QPoint pos
         // on the lower level part of the bar
         if (m_currentIndex == -1)
             return qMakePair(HITNOTHING, -1);
-        Tab currentTab = m_tabs.at(m_currentIndex);
-        QStringList subTabs = currentTab.subTabs;
-        if (subTabs.isEmpty())
+        if (m_subTabWidths.isEmpty())
             return qMakePair(HITNOTHING, -1);
         int eventX = pos.x();
-        QFontMetrics fm(font());
         int x = MARGIN;
         int i;
-        for (i = 0; i < subTabs.size(); ++i) {
-            int otherX = x + 2 * SELECTION_IMAGE_WIDTH + fm.width(subTabs.at(i));
+        for (i = 0; i < m_subTabWidths.size(); ++i) {
+            int otherX = x + 2 * SELECTION_IMAGE_WIDTH + m_subTabWidths.at(i);
             if (eventX > x && eventX < otherX) {
                 break;
             }
             x = otherX + 2 * MARGIN;
         }
-        if (i < subTabs.size()) {
+        if (i < m_subTabWidths.size()) {
             return qMakePair(HITSUBTAB, i);
         }
     }
@@ -286,29 +570,27 @@ void DoubleTabWidget::mousePressEvent(QMouseEvent *event)
     // should not make any difference
     QPair<HitArea, int> hit = convertPosToTab(event->pos());
     if (hit.first == HITTAB) {
-        if (m_currentIndex != m_currentTabIndices.at(hit.second)) {
-            m_currentIndex = m_currentTabIndices.at(hit.second);
-            update();
+        if (m_currentIndex != tabAtSlot(hit.second)) {
+            m_currentIndex = tabAtSlot(hit.second);
+            invalidateLayout();
             event->accept();
             emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
             return;
         }
     } else if (hit.first == HITOVERFLOW) {
-        QMenu overflowMenu;
-        QList<QAction *> actions;
-        for (int i = m_lastVisibleIndex + 1; i < m_tabs.size(); ++i) {
-            actions << overflowMenu.addAction(m_tabs.at(m_currentTabIndices.at(i)).displayName());
-        }
-        if (QAction *action = overflowMenu.exec(event->globalPos())) { // todo used different position before
-            int index = m_currentTabIndices.at(actions.indexOf(action) + m_lastVisibleIndex + 1);
-            if (m_currentIndex != index) {
-                m_currentIndex = index;
-                update();
-                event->accept();
-                emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
-                return;
-            }
+        if (!m_overflowPopup) {
+            m_overflowPopup = new TabOverflowPopup(this);
+            QStringList names;
+            names.reserve(m_tabs.size());
+            foreach (const Tab &tab, m_tabs)
+                names << displayName(tab);
+            m_overflowPopup->setTabNames(names);
+            connect(m_overflowPopup, SIGNAL(tabSelected(int)), this, SLOT(overflowTabSelected(int)));
         }
+        m_overflowPopup->popup(event->globalPos(), m_visibleCount,
+                               m_currentPinned ? m_currentIndex : -1);
+        event->accept();
+        return;
     } else if (hit.first == HITSUBTAB) {
         if (m_tabs[m_currentIndex].currentSubTab != hit.second) {
             m_tabs[m_currentIndex].currentSubTab = hit.second;
@@ -323,17 +605,34 @@ void DoubleTabWidget::mousePressEvent(QMouseEvent *event)
     event->ignore();
 }
 
-void DoubleTabWidget::paintEvent(QPaintEvent *event)
+void DoubleTabWidget::overflowTabSelected(int index)
 {
-    Q_UNUSED(event)
-    QPainter painter(this);
+    if (index == m_currentIndex || index >= m_tabs.size())
+        return;
+    m_currentIndex = index;
+    invalidateLayout();
+    emit currentIndexChanged(m_currentIndex, m_tabs.at(m_currentIndex).currentSubTab);
+}
+
+void DoubleTabWidget::ensureChrome(const QRect &gradientSpan)
+{
+    const QSize chromeSize(width(), Utils::StyleHelper::navigationWidgetHeight() + OTHER_HEIGHT + 1);
+    const QRgb baseColor = Utils::StyleHelper::baseColor().rgb();
+    const qreal pixelRatio = chromePixelRatio(this);
+    if (!m_chrome.isNull() && m_chromeSize == chromeSize && m_chromeDevicePixelRatio == pixelRatio
+            && m_chromeGradientSpan == gradientSpan && m_chromeBaseColor == baseColor)
+        return;
+    m_chromeGradientSpan = gradientSpan;
+    m_chromeBaseColor = baseColor;
+    m_chromeSize = chromeSize;
+    m_chromeDevicePixelRatio = pixelRatio;
+
+    m_chrome = createChromePixmap(chromeSize, pixelRatio);
+    QPainter painter(&m_chrome);
     QRect r = rect();
 
     // draw top level tab bar
     r.setHeight(Utils::StyleHelper::navigationWidgetHeight());
-
-    QPoint offset = window()->mapToGlobal(QPoint(0, 0)) - mapToGlobal(r.topLeft());
-    QRect gradientSpan = QRect(offset, window()->size());
     Utils::StyleHelper::horizontalGradient(&painter, gradientSpan, r);
 
     painter.setPen(Utils::StyleHelper::borderColor());
@@ -343,15 +642,6 @@ void DoubleTabWidget::paintEvent(QPaintEvent *event)
     painter.setPen(lighter);
     painter.drawLine(r.topLeft(), r.topRight());
 
-    QFontMetrics fm(font());
-    int baseline = (r.height() + fm.ascent()) / 2 - 1;
-
-    // top level title
-    if (!m_title.isEmpty()) {
-        painter.setPen(Utils::StyleHelper::panelTextColor());
-        painter.drawText(MARGIN, baseline, m_title);
-    }
-
     QLinearGradient grad(QPoint(0, 0), QPoint(0, r.height() + OTHER_HEIGHT - 1));
     grad.setColorAt(0, QColor(247, 247, 247));
     grad.setColorAt(1, QColor(205, 205, 205));
@@ -366,81 +656,15 @@ void DoubleTabWidget::paintEvent(QPaintEvent *event)
                      r.width(), r.height());
 
     // top level tabs
-    int x = m_title.isEmpty() ? 0 :
-            2 * MARGIN + qMax(fm.width(m_title), MIN_LEFT_MARGIN);
-
-    // calculate sizes
-    QList<int> nameWidth;
-    int width = x;
-    int indexSmallerThanOverflow = -1;
-    int indexSmallerThanWidth = -1;
-    for (int i = 0; i < m_tabs.size(); ++i) {
-        const Tab &tab = m_tabs.at(i);
-        int w = fm.width(tab.displayName());
-        nameWidth << w;
-        width += 2 * MARGIN + w;
-        if (width < r.width())
-            indexSmallerThanWidth = i;
-        if (width < r.width() - OVERFLOW_DROPDOWN_WIDTH)
-            indexSmallerThanOverflow = i;
-    }
-    m_lastVisibleIndex = -1;
-    m_currentTabIndices.resize(m_tabs.size());
-    if (indexSmallerThanWidth == m_tabs.size() - 1) {
-        // => everything fits
-        for (int i = 0; i < m_tabs.size(); ++i)
-            m_currentTabIndices[i] = i;
-        m_lastVisibleIndex = m_tabs.size()-1;
-    } else {
-        // => we need the overflow thingy
-        if (m_currentIndex <= indexSmallerThanOverflow) {
-            // easy going, simply draw everything that fits
-            for (int i = 0; i < m_tabs.size(); ++i)
-                m_currentTabIndices[i] = i;
-            m_lastVisibleIndex = indexSmallerThanOverflow;
-        } else {
-            // now we need to put the current tab into
-            // visible range. for that we need to find the place
-            // to put it, so it fits
-            width = x;
-            int index = 0;
-            bool handledCurrentIndex = false;
-            for (int i = 0; i < m_tabs.size(); ++i) {
-                if (index != m_currentIndex) {
-                    if (!handledCurrentIndex) {
-                        // check if enough room for current tab after this one
-                        if (width + 2 * MARGIN + nameWidth.at(index)
-                                + 2 * MARGIN + nameWidth.at(m_currentIndex)
-                                < r.width() - OVERFLOW_DROPDOWN_WIDTH) {
-                            m_currentTabIndices[i] = index;
-                            ++index;
-                            width += 2 * MARGIN + nameWidth.at(index);
-                        } else {
-                            m_currentTabIndices[i] = m_currentIndex;
-                            handledCurrentIndex = true;
-                            m_lastVisibleIndex = i;
-                        }
-                    } else {
-                        m_currentTabIndices[i] = index;
-                        ++index;
-                    }
-                } else {
-                    ++index;
-                    --i;
-                }
-            }
-        }
-    }
-
-    // actually draw top level tabs
+    int x = m_tabsLeft;
     for (int i = 0; i <= m_lastVisibleIndex; ++i) {
-        int actualIndex = m_currentTabIndices.at(i);
-        Tab tab = m_tabs.at(actualIndex);
+        int actualIndex = tabAtSlot(i);
+        const int nameWidth = m_nameWidths.at(actualIndex);
         if (actualIndex == m_currentIndex) {
             painter.setPen(Utils::StyleHelper::borderColor());
             painter.drawLine(x - 1, 0, x - 1, r.height() - 1);
             painter.fillRect(QRect(x, 0,
-                                   2 * MARGIN + fm.width(tab.displayName()),
+                                   2 * MARGIN + nameWidth,
                                    r.height() + 1),
                              grad);
 
@@ -448,11 +672,7 @@ void DoubleTabWidget::paintEvent(QPaintEvent *event)
                 painter.setPen(QColor(255, 255, 255, 170));
                 painter.drawLine(x, 0, x, r.height());
             }
-            x += MARGIN;
-            painter.setPen(Qt::black);
-            painter.drawText(x, baseline, tab.displayName());
-            x += nameWidth.at(actualIndex);
-            x += MARGIN;
+            x += 2 * MARGIN + nameWidth;
             painter.setPen(Utils::StyleHelper::borderColor());
             painter.drawLine(x, 0, x, r.height() - 1);
             painter.setPen(QColor(0, 0, 0, 20));
@@ -462,11 +682,7 @@ void DoubleTabWidget::paintEvent(QPaintEvent *event)
         } else {
             if (i == 0)
                 drawFirstLevelSeparator(&painter, QPoint(x, 0), QPoint(x, r.height()-1));
-            x += MARGIN;
-            painter.setPen(Utils::StyleHelper::panelTextColor());
-            painter.drawText(x + 1, baseline, tab.displayName());
-            x += nameWidth.at(actualIndex);
-            x += MARGIN;
+            x += 2 * MARGIN + nameWidth;
             drawFirstLevelSeparator(&painter, QPoint(x, 0), QPoint(x, r.height()-1));
         }
     }
@@ -481,16 +697,64 @@ void DoubleTabWidget::paintEvent(QPaintEvent *event)
                                 QPoint(x + OVERFLOW_DROPDOWN_WIDTH, r.height()-1));
     }
 
-    // second level tabs
+    // second level separators
     if (m_currentIndex != -1) {
         int y = r.height() + (OTHER_HEIGHT - m_left.height()) / 2.;
         int imageHeight = m_left.height();
-        Tab currentTab = m_tabs.at(m_currentIndex);
-        QStringList subTabs = currentTab.subTabs;
+        x = 0;
+        for (int i = 0; i < m_subTabWidths.size(); ++i) {
+            x += MARGIN + 2 * SELECTION_IMAGE_WIDTH + m_subTabWidths.at(i) + MARGIN;
+            drawSecondLevelSeparator(&painter, QPoint(x, y), QPoint(x, y + imageHeight));
+        }
+    }
+}
+
+void DoubleTabWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    ensureLayout();
+    ensureChrome(QRect(-mapTo(window(), QPoint(0, 0)), window()->size()));
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, m_chrome);
+
+    const int topHeight = Utils::StyleHelper::navigationWidgetHeight();
+    QFontMetrics fm(font());
+    int baseline = (topHeight + fm.ascent()) / 2 - 1;
+
+    // top level title
+    if (!m_title.isEmpty()) {
+        painter.setPen(Utils::StyleHelper::panelTextColor());
+        painter.drawText(MARGIN, baseline, m_title);
+    }
+
+    // top level tabs
+    int x = m_tabsLeft;
+    for (int i = 0; i <= m_lastVisibleIndex; ++i) {
+        int actualIndex = tabAtSlot(i);
+        const Tab &tab = m_tabs.at(actualIndex);
+        x += MARGIN;
+        if (actualIndex == m_currentIndex) {
+            painter.setPen(Qt::black);
+            painter.drawText(x, baseline, displayName(tab));
+        } else {
+            painter.setPen(Utils::StyleHelper::panelTextColor());
+            painter.drawText(x + 1, baseline, displayName(tab));
+        }
+        x += m_nameWidths.at(actualIndex);
+        x += MARGIN;
+    }
+
+    // second level tabs
+    if (m_currentIndex != -1) {
+        int y = topHeight + (OTHER_HEIGHT - m_left.height()) / 2.;
+        int imageHeight = m_left.height();
+        const Tab &currentTab = m_tabs.at(m_currentIndex);
+        const QStringList &subTabs = currentTab.subTabs;
         x = 0;
         for (int i = 0; i < subTabs.size(); ++i) {
             x += MARGIN;
-            int textWidth = fm.width(subTabs.at(i));
+            int textWidth = m_subTabWidths.at(i);
             if (currentTab.currentSubTab == i) {
                 painter.setPen(Qt::white);
                 painter.drawPixmap(x, y, m_left);
@@ -505,11 +769,16 @@ void DoubleTabWidget::paintEvent(QPaintEvent *event)
             painter.drawText(x, y + (imageHeight + fm.ascent()) / 2. - 1,
                              subTabs.at(i));
             x += textWidth + SELECTION_IMAGE_WIDTH + MARGIN;
-            drawSecondLevelSeparator(&painter, QPoint(x, y), QPoint(x, y + imageHeight));
         }
     }
 }
 
+void DoubleTabWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    invalidateLayout();
+}
+
 void DoubleTabWidget::changeEvent(QEvent *e)
 {
     QWidget::changeEvent(e);
@@ -517,6 +786,11 @@ void DoubleTabWidget::changeEvent(QEvent *e)
     case QEvent::LanguageChange:
         ui->retranslateUi(this);
         break;
+    case QEvent::FontChange:
+    case QEvent::StyleChange:
+        m_nameWidths.fill(-1);
+        invalidateTabWidths();
+        break;
     default:
         break;
     }
@@ -527,8 +801,8 @@ bool DoubleTabWidget::event(QEvent *event)
     if (event->type() == QEvent::ToolTip) {
         QHelpEvent *helpevent = static_cast<QHelpEvent*>(event);
         QPair<HitArea, int> hit = convertPosToTab(helpevent->pos());
-        if (hit.first == HITTAB && m_tabs.at(m_currentTabIndices.at(hit.second)).nameIsUnique)
-            QToolTip::showText(helpevent->globalPos(), m_tabs.at(m_currentTabIndices.at(hit.second)).fullName, this);
+        if (hit.first == HITTAB && nameIsUnique(m_tabs.at(tabAtSlot(hit.second))))
+            QToolTip::showText(helpevent->globalPos(), m_tabs.at(tabAtSlot(hit.second)).fullName, this);
         else
             QToolTip::showText(helpevent->globalPos(), QString(), this);
     }
@@ -30,17 +30,28 @@
 #ifndef DOUBLETABWIDGET_H
 #define DOUBLETABWIDGET_H
 
+#include "qt-manhattan-style_global.hpp"
+
+#include <QHash>
+#include <QSet>
 #include <QVector>
 #include <QWidget>
 #include <QPixmap>
 
+QT_BEGIN_NAMESPACE
+class QAbstractItemModel;
+class QModelIndex;
+QT_END_NAMESPACE
+
 namespace Manhattan {
 
+class TabOverflowPopup;
+
 namespace Ui {
     class DoubleTabWidget;
 }
 
-class DoubleTabWidget : public QWidget
+class QTMANHATTANSTYLESHARED_EXPORT DoubleTabWidget : public QWidget
 {
     Q_OBJECT
 public:
@@ -51,6 +62,9 @@ public:
     QString title() const { return m_title; }
 
     void addTab(const QString &name, const QString &fullName, const QStringList &subTabs);
+    // Appends several tabs at once, the lists must have the same size
+    void addTabs(const QStringList &names, const QStringList &fullNames,
+                 const QList<QStringList> &subTabs);
     void insertTab(int index, const QString &name, const QString &fullName, const QStringList &subTabs);
     void removeTab(int index);
     int tabCount() const;
@@ -60,12 +74,29 @@ public:
 
     int currentSubIndex() const;
 
+    // Binds the tabs to the top level rows of model and the sub tabs to
+    // their child rows, using column 0. Names are taken from Qt::DisplayRole,
+    // full names from Qt::ToolTipRole. Changes of the model are applied
+    // incrementally. Tabs must not be added or removed by hand while a
+    // model is set.
+    void setModel(QAbstractItemModel *model);
+    QAbstractItemModel *model() const { return m_model; }
+
 signals:
     void currentIndexChanged(int index, int subIndex);
 
+private slots:
+    void modelRowsInserted(const QModelIndex &parent, int first, int last);
+    void modelRowsRemoved(const QModelIndex &parent, int first, int last);
+    void modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void modelReset();
+    void modelDestroyed();
+    void overflowTabSelected(int index);
+
 protected:
     void paintEvent(QPaintEvent *event);
     void mousePressEvent(QMouseEvent *event);
+    void resizeEvent(QResizeEvent *event);
     void changeEvent(QEvent *e);
     bool event(QEvent *event);
     QSize minimumSizeHint() const;
@@ -74,19 +105,36 @@ private:
     struct Tab {
         QString name;
         QString fullName;
-        bool nameIsUnique;
         QStringList subTabs;
         int currentSubTab;
-        QString displayName() const {
-            return nameIsUnique ? name : fullName;
-        }
     };
-    void updateNameIsUniqueAdd(Tab *tab);
-    void updateNameIsUniqueRemove(const Tab &tab);
+    // Uniqueness is looked up in m_nameCounts, which counts the tabs per name
+    bool nameIsUnique(const Tab &tab) const {
+        return m_nameCounts.value(tab.name) == 1;
+    }
+    QString displayName(const Tab &tab) const {
+        return nameIsUnique(tab) ? tab.name : tab.fullName;
+    }
+    void insertTabEntry(int index, const QString &name, const QString &fullName, const QStringList &subTabs);
+    void removeTabEntry(int index);
+    void addName(const QString &name);
+    void removeName(const QString &name);
+    void insertTabsFromModel(int first, int last);
+    void subTabsChanged(int index, bool currentSubTabChanged);
 
     enum HitArea { HITNOTHING, HITOVERFLOW, HITTAB, HITSUBTAB };
     QPair<DoubleTabWidget::HitArea, int> convertPosToTab(QPoint pos);
 
+    // The layout is computed lazily. Only tabs with an unknown width (-1 in
+    // m_nameWidths) are measured again, other changes only rearrange them.
+    void invalidateLayout();
+    void invalidateTabWidths();
+    void ensureLayout();
+    int tabAtSlot(int slot) const;
+    // Renders the backgrounds and separators, which only change with the
+    // layout, the size and the base color. Text is drawn over it.
+    void ensureChrome(const QRect &gradientSpan);
+
     const QPixmap m_left;
     const QPixmap m_mid;
     const QPixmap m_right;
@@ -96,9 +144,31 @@ private:
 
     QString m_title;
     QList<Tab> m_tabs;
+    QHash<QString, int> m_nameCounts;
+    // Names whose count crossed between one and two, so their tabs switch
+    // between name and full name. Resolved in ensureLayout().
+    QSet<QString> m_dirtyNames;
+    QAbstractItemModel *m_model;
     int m_currentIndex;
-    QVector<int> m_currentTabIndices;
     int m_lastVisibleIndex;
+
+    // Cached layout, see ensureLayout()
+    bool m_layoutDirty;
+    bool m_tabWidthsDirty;
+    int m_tabsLeft;
+    QVector<int> m_nameWidths;
+    QVector<int> m_tabOffsets;
+    int m_visibleCount;
+    bool m_currentPinned;
+    QVector<int> m_subTabWidths;
+    TabOverflowPopup *m_overflowPopup;
+
+    // m_chrome has m_chromeSize at the widget's device pixel ratio
+    QPixmap m_chrome;
+    QSize m_chromeSize;
+    qreal m_chromeDevicePixelRatio;
+    QRect m_chromeGradientSpan;
+    QRgb m_chromeBaseColor;
 };
 
 } // namespace Manhattan
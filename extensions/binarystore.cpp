@@ -0,0 +1,375 @@
+#include "binarystore.h"
+#include <QDataStream>
+#include <QSettings>
+#include <QDebug>
+#if QT_VERSION >= 0x050100
+#include <QLockFile>
+#include <QSaveFile>
+#endif
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#include <qt_windows.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace Manhattan;
+
+static const quint32 STORE_MAGIC = 0x514d5342; // "QMSB"
+static const quint32 STORE_VERSION = 1;
+static const int STREAM_VERSION = QDataStream::Qt_4_8;
+// magic and version
+static const int HEADER_SIZE = 8;
+// payload size and checksum
+static const int RECORD_HEADER_SIZE = 6;
+// outdated records are kept until there are at least this many bytes of them
+static const qint64 COMPACT_MIN_GARBAGE = 64 * 1024;
+// how long to wait for another process writing the file, in milliseconds
+static const int LOCK_TIMEOUT = 10000;
+
+enum RecordKind { RemovedRecord = 0, ValueRecord = 1 };
+
+static QByteArray encodeHeader()
+{
+    QByteArray header;
+    QDataStream stream(&header, QIODevice::WriteOnly);
+    stream << STORE_MAGIC << STORE_VERSION;
+    return header;
+}
+
+// A record is the size and checksum of its payload, followed by the
+// payload: the key, the kind and for ValueRecords the value.
+static QByteArray encodeRecord(const QString &key, const QVariant &value)
+{
+    QByteArray payload;
+    {
+        QDataStream stream(&payload, QIODevice::WriteOnly);
+        stream.setVersion(STREAM_VERSION);
+        stream << key;
+        if (value.isValid())
+            stream << quint8(ValueRecord) << value;
+        else
+            stream << quint8(RemovedRecord);
+    }
+    QByteArray record;
+    {
+        QDataStream stream(&record, QIODevice::WriteOnly);
+        stream << quint32(payload.size()) << qChecksum(payload.constData(), payload.size());
+    }
+    record.append(payload);
+    return record;
+}
+
+// Makes sure written data survives a crash of the system, flush() only
+// hands it to the operating system
+static bool syncFile(QFile &file)
+{
+    if (!file.flush())
+        return false;
+#ifdef Q_OS_WIN
+    return FlushFileBuffers(reinterpret_cast<HANDLE>(_get_osfhandle(file.handle())));
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+static bool writeFile(const QString &fileName, const QByteArray &data)
+{
+#if QT_VERSION >= 0x050100
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size())
+        return false;
+    return file.commit();
+#else
+    const QString tempName = fileName + QLatin1String(".tmp");
+    QFile file(tempName);
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size() || !syncFile(file))
+        return false;
+    file.close();
+    QFile::remove(fileName);
+    return QFile::rename(tempName, fileName);
+#endif
+}
+
+BinaryStore::BinaryStore(const QString &fileName) :
+    m_fileName(fileName),
+    m_map(0),
+    m_fileSize(0),
+    m_garbageSize(0),
+    m_foreign(false)
+{
+    load();
+}
+
+BinaryStore::~BinaryStore()
+{
+    unmap();
+}
+
+void BinaryStore::load()
+{
+    m_mapFile.setFileName(m_fileName);
+    if (!m_mapFile.exists() || !m_mapFile.open(QIODevice::ReadOnly))
+        return;
+    const qint64 size = m_mapFile.size();
+    if (size < HEADER_SIZE || !(m_map = m_mapFile.map(0, size))) {
+        m_mapFile.close();
+        return;
+    }
+
+    quint32 magic = 0;
+    quint32 version = 0;
+    QDataStream header(QByteArray::fromRawData(reinterpret_cast<const char *>(m_map), HEADER_SIZE));
+    header >> magic >> version;
+    if (magic != STORE_MAGIC || version != STORE_VERSION) {
+        qWarning() << "BinaryStore: ignoring" << m_fileName << "with unknown format";
+        m_foreign = true;
+        unmap();
+        return;
+    }
+
+    qint64 pos = HEADER_SIZE;
+    while (pos + RECORD_HEADER_SIZE <= size) {
+        const char *data = reinterpret_cast<const char *>(m_map) + pos;
+        quint32 payloadSize = 0;
+        quint16 checksum = 0;
+        QDataStream recordHeader(QByteArray::fromRawData(data, RECORD_HEADER_SIZE));
+        recordHeader >> payloadSize >> checksum;
+        if (payloadSize > quint64(size - pos - RECORD_HEADER_SIZE))
+            break;
+        const char *payload = data + RECORD_HEADER_SIZE;
+        if (qChecksum(payload, payloadSize) != checksum)
+            break;
+
+        QString key;
+        quint8 kind = RemovedRecord;
+        QDataStream stream(QByteArray::fromRawData(payload, payloadSize));
+        stream.setVersion(STREAM_VERSION);
+        stream >> key >> kind;
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        const int recordSize = RECORD_HEADER_SIZE + payloadSize;
+        m_garbageSize += m_recordSizes.value(key);
+        if (kind == ValueRecord) {
+            const Record record = { pos + RECORD_HEADER_SIZE, int(payloadSize) };
+            m_mapped.insert(key, record);
+            m_recordSizes.insert(key, recordSize);
+        } else {
+            m_mapped.remove(key);
+            m_recordSizes.remove(key);
+            m_garbageSize += recordSize;
+        }
+        pos += recordSize;
+    }
+    m_fileSize = pos;
+}
+
+// Parses the file again, after it changed behind our back. Every value
+// is in the file, so nothing in memory is lost.
+void BinaryStore::reload()
+{
+    unmap();
+    m_mapped.clear();
+    m_values.clear();
+    m_recordSizes.clear();
+    m_fileSize = 0;
+    m_garbageSize = 0;
+    m_foreign = false;
+    load();
+}
+
+bool BinaryStore::moveForeignFileAside()
+{
+    QString backupName = m_fileName + QLatin1String(".bak");
+    for (int i = 1; QFile::exists(backupName); ++i)
+        backupName = m_fileName + QLatin1String(".bak") + QString::number(i);
+    if (!QFile::rename(m_fileName, backupName)) {
+        qWarning() << "BinaryStore: cannot move" << m_fileName << "aside, not writing it";
+        return false;
+    }
+    qWarning() << "BinaryStore: moved" << m_fileName << "to" << backupName;
+    m_foreign = false;
+    return true;
+}
+
+void BinaryStore::unmap()
+{
+    if (m_map) {
+        m_mapFile.unmap(m_map);
+        m_map = 0;
+    }
+    m_mapFile.close();
+}
+
+QVariant BinaryStore::decodeValue(const Record &record) const
+{
+    QDataStream stream(QByteArray::fromRawData(reinterpret_cast<const char *>(m_map) + record.offset,
+                                               record.size));
+    stream.setVersion(STREAM_VERSION);
+    QString key;
+    quint8 kind;
+    QVariant value;
+    stream >> key >> kind >> value;
+    return value;
+}
+
+QStringList BinaryStore::keys() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_recordSizes.keys();
+}
+
+bool BinaryStore::contains(const QString &key) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_recordSizes.contains(key);
+}
+
+QVariant BinaryStore::value(const QString &key, const QVariant &defaultValue) const
+{
+    QMutexLocker locker(&m_mutex);
+    QHash<QString, QVariant>::const_iterator it = m_values.constFind(key);
+    if (it != m_values.constEnd())
+        return it->isValid() ? *it : defaultValue;
+    QHash<QString, Record>::const_iterator record = m_mapped.constFind(key);
+    if (record == m_mapped.constEnd())
+        return defaultValue;
+    return decodeValue(*record);
+}
+
+bool BinaryStore::setValue(const QString &key, const QVariant &value)
+{
+    QHash<QString, QVariant> values;
+    values.insert(key, value);
+    return setValues(values);
+}
+
+bool BinaryStore::setValues(const QHash<QString, QVariant> &values)
+{
+    QMutexLocker locker(&m_mutex);
+#if QT_VERSION >= 0x050100
+    QLockFile lock(lockFileName());
+    if (!lock.tryLock(LOCK_TIMEOUT)) {
+        qWarning() << "BinaryStore: cannot lock" << m_fileName << "for writing";
+        return false;
+    }
+#endif
+    if (!appendRecords(values))
+        return false;
+    if (m_garbageSize > COMPACT_MIN_GARBAGE && m_garbageSize > m_fileSize / 2)
+        compactLocked();
+    return true;
+}
+
+bool BinaryStore::remove(const QString &key)
+{
+    return setValue(key, QVariant());
+}
+
+// Expects the lock file to be held
+bool BinaryStore::appendRecords(const QHash<QString, QVariant> &values)
+{
+    if (m_foreign && !moveForeignFileAside())
+        return false;
+
+    QFile file(m_fileName);
+    if (!file.open(QIODevice::ReadWrite)) {
+        qWarning() << "BinaryStore: cannot write" << m_fileName << file.errorString();
+        return false;
+    }
+    if (file.size() != m_fileSize) {
+        // Another process appended or compacted, take its records over
+        reload();
+        if (m_foreign) {
+            file.close();
+            if (!moveForeignFileAside() || !file.open(QIODevice::ReadWrite))
+                return false;
+        }
+        // Only a torn or corrupt tail is left beyond the valid records
+        if (file.size() > m_fileSize && !file.resize(m_fileSize)) {
+            qWarning() << "BinaryStore: cannot write" << m_fileName << file.errorString();
+            return false;
+        }
+    }
+
+    QByteArray data;
+    if (m_fileSize == 0)
+        data = encodeHeader();
+    QHash<QString, int> recordSizes;
+    QHash<QString, QVariant>::const_iterator it = values.constBegin();
+    for ( ; it != values.constEnd(); ++it) {
+        const QByteArray record = encodeRecord(it.key(), it.value());
+        recordSizes.insert(it.key(), record.size());
+        data.append(record);
+    }
+
+    if (!file.seek(m_fileSize) || file.write(data) != data.size() || !syncFile(file)) {
+        qWarning() << "BinaryStore: cannot write" << m_fileName << file.errorString();
+        file.resize(m_fileSize);
+        return false;
+    }
+    m_fileSize += data.size();
+
+    for (it = values.constBegin(); it != values.constEnd(); ++it) {
+        m_garbageSize += m_recordSizes.value(it.key());
+        if (it.value().isValid()) {
+            m_recordSizes.insert(it.key(), recordSizes.value(it.key()));
+        } else {
+            m_recordSizes.remove(it.key());
+            m_garbageSize += recordSizes.value(it.key());
+        }
+        m_values.insert(it.key(), it.value());
+    }
+    return true;
+}
+
+bool BinaryStore::compact()
+{
+    QMutexLocker locker(&m_mutex);
+#if QT_VERSION >= 0x050100
+    QLockFile lock(lockFileName());
+    if (!lock.tryLock(LOCK_TIMEOUT)) {
+        qWarning() << "BinaryStore: cannot lock" << m_fileName << "for compacting";
+        return false;
+    }
+#endif
+    return compactLocked();
+}
+
+// Expects the lock file to be held
+bool BinaryStore::compactLocked()
+{
+    // Records other processes appended since are kept
+    reload();
+    if (m_foreign)
+        return moveForeignFileAside();
+    QByteArray data = encodeHeader();
+    foreach (const QString &key, m_recordSizes.keys()) {
+        QHash<QString, QVariant>::const_iterator it = m_values.constFind(key);
+        const QVariant value = it != m_values.constEnd() ? *it : decodeValue(m_mapped.value(key));
+        data.append(encodeRecord(key, value));
+    }
+
+    // The file must not be mapped while it is replaced. Every value is in
+    // the file at this point, so loading it again is always consistent.
+    unmap();
+    const bool ok = writeFile(m_fileName, data);
+    if (!ok)
+        qWarning() << "BinaryStore: cannot compact" << m_fileName;
+    reload();
+    return ok;
+}
+
+int BinaryStore::importKeys(const QSettings *settings, const QString &prefix)
+{
+    QHash<QString, QVariant> values;
+    foreach (const QString &key, settings->allKeys()) {
+        if (key.startsWith(prefix))
+            values.insert(key, settings->value(key));
+    }
+    if (values.isEmpty() || !setValues(values))
+        return 0;
+    return values.size();
+}
@@ -0,0 +1,85 @@
+#ifndef BINARYSTORE_H
+#define BINARYSTORE_H
+
+#include "../qt-manhattan-style_global.hpp"
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+#include <QVariant>
+
+class QSettings;
+
+namespace Manhattan {
+
+// Key value store in a single file, a compact alternative to QSettings.
+// The file is a versioned log of length prefixed, checksummed records.
+// Changes are appended, the last record of a key wins. On load the file
+// is memory mapped and values are only decoded when they are read.
+// A torn record at the end of the file is dropped. A file in another
+// format is moved aside to a backup on the first write. Processes sharing
+// the file take turns writing through a lock file next to it, and load
+// the records of the others before appending or compacting (the lock
+// needs Qt 5.1 or later). All functions are thread safe.
+class QTMANHATTANSTYLESHARED_EXPORT BinaryStore
+{
+public:
+    explicit BinaryStore(const QString &fileName);
+    ~BinaryStore();
+
+    QString fileName() const { return m_fileName; }
+
+    QStringList keys() const;
+    bool contains(const QString &key) const;
+    QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+    bool setValue(const QString &key, const QVariant &value);
+    // Appends all values at once, an invalid value removes its key
+    bool setValues(const QHash<QString, QVariant> &values);
+    bool remove(const QString &key);
+
+    // Rewrites the file with the last record of each key. This also
+    // happens by itself once most of the file is outdated.
+    bool compact();
+
+    // Converter from QSettings, copies the keys starting with prefix and
+    // returns how many. The state FancyMainWindow saved in a group of the
+    // settings converts with the prefix group + '/'.
+    int importKeys(const QSettings *settings, const QString &prefix = QString());
+
+private:
+    Q_DISABLE_COPY(BinaryStore)
+
+    struct Record {
+        qint64 offset;
+        int size;
+    };
+
+    void load();
+    void reload();
+    void unmap();
+    bool moveForeignFileAside();
+    QVariant decodeValue(const Record &record) const;
+    QString lockFileName() const { return m_fileName + QLatin1String(".lock"); }
+    bool appendRecords(const QHash<QString, QVariant> &values);
+    bool compactLocked();
+
+    QString m_fileName;
+    mutable QMutex m_mutex;
+    QFile m_mapFile;
+    uchar *m_map;
+    // payloads of the values in the mapped file
+    QHash<QString, Record> m_mapped;
+    // values appended since, invalid ones are removed
+    QHash<QString, QVariant> m_values;
+    // size of the last record of each key, to account for outdated ones
+    QHash<QString, int> m_recordSizes;
+    // end of the last valid record
+    qint64 m_fileSize;
+    qint64 m_garbageSize;
+    // the file exists but is not a BinaryStore
+    bool m_foreign;
+};
+
+} // namespace Manhattan
+
+#endif // BINARYSTORE_H
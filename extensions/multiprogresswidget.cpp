@@ -0,0 +1,328 @@
+#include "multiprogresswidget.h"
+#include "../stylehelper.h"
+#include "pixelratio_p.h"
+
+#include <QAbstractItemModel>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+
+using namespace Manhattan;
+
+static const int INDENT = 6;
+// odd, like the bar of ProgressBar
+static const int BAR_HEIGHT = 13;
+static const int MIN_BAR_WIDTH = 50;
+
+// The frame image is shared by all widgets
+static const QImage &barImage()
+{
+    static const QImage image(QLatin1String(":/core/images/progressbar.png"));
+    return image;
+}
+
+static QColor stateColor(MultiProgressWidget::TaskState state)
+{
+    switch (state) {
+    case MultiProgressWidget::TaskFinished:
+        return QColor(90, 170, 60);
+    case MultiProgressWidget::TaskFailed:
+        return QColor(255, 60, 0, 210);
+    default:
+        break;
+    }
+    QColor c = Utils::StyleHelper::panelTextColor();
+    c.setAlpha(180);
+    return c;
+}
+
+MultiProgressWidget::MultiProgressWidget(QWidget *parent) :
+    QWidget(parent),
+    m_model(0),
+    m_layoutValid(false),
+    m_titleWidth(0),
+    m_chromeDevicePixelRatio(1)
+{
+    m_stateCounts[TaskRunning] = m_stateCounts[TaskFinished] = m_stateCounts[TaskFailed] = 0;
+    setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+}
+
+MultiProgressWidget::~MultiProgressWidget()
+{
+}
+
+void MultiProgressWidget::setModel(QAbstractItemModel *model)
+{
+    if (model == m_model)
+        return;
+    if (m_model)
+        disconnect(m_model, 0, this, 0);
+    m_model = model;
+    if (m_model) {
+        connect(m_model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                this, SLOT(modelRowsInserted(QModelIndex,int,int)));
+        connect(m_model, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                this, SLOT(modelRowsRemoved(QModelIndex,int,int)));
+        connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                this, SLOT(modelDataChanged(QModelIndex,QModelIndex)));
+        connect(m_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+                this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(layoutChanged()), this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(modelReset()), this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(destroyed()), this, SLOT(modelDestroyed()));
+    }
+    modelReset();
+}
+
+MultiProgressWidget::Task MultiProgressWidget::taskFromModel(int row) const
+{
+    const QModelIndex index = m_model->index(row, 0);
+    Task task;
+    task.title = index.data().toString();
+    const QVariant minimum = index.data(MinimumRole);
+    task.minimum = minimum.isValid() ? minimum.toInt() : 0;
+    const QVariant maximum = index.data(MaximumRole);
+    task.maximum = maximum.isValid() ? maximum.toInt() : 100;
+    task.value = index.data(ValueRole).toInt();
+    const int state = index.data(StateRole).toInt();
+    task.state = state == TaskFinished || state == TaskFailed ? TaskState(state) : TaskRunning;
+    return task;
+}
+
+void MultiProgressWidget::setTask(int row, const Task &task)
+{
+    Task &old = m_tasks[row];
+    --m_stateCounts[old.state];
+    ++m_stateCounts[task.state];
+    const QString elidedTitle = old.title == task.title ? old.elidedTitle : QString();
+    old = task;
+    old.elidedTitle = elidedTitle;
+}
+
+void MultiProgressWidget::tasksChanged()
+{
+    // rows move, so everything is repainted
+    updateGeometry();
+    update();
+}
+
+void MultiProgressWidget::modelRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+    for (int row = first; row <= last; ++row) {
+        const Task task = taskFromModel(row);
+        ++m_stateCounts[task.state];
+        m_tasks.insert(row, task);
+    }
+    tasksChanged();
+}
+
+void MultiProgressWidget::modelRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+    for (int row = first; row <= last; ++row)
+        --m_stateCounts[m_tasks.at(row).state];
+    m_tasks.remove(first, last - first + 1);
+    tasksChanged();
+}
+
+void MultiProgressWidget::modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    // only the first column of top level rows is shown
+    if (topLeft.parent().isValid() || topLeft.column() > 0)
+        return;
+    const int running = runningCount();
+    const int failed = failedCount();
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row)
+        setTask(row, taskFromModel(row));
+    QRect dirty = rowRect(topLeft.row()).united(rowRect(bottomRight.row()));
+    if (running != runningCount() || failed != failedCount())
+        dirty |= rowRect(-1);
+    update(dirty);
+}
+
+void MultiProgressWidget::modelReset()
+{
+    m_tasks.clear();
+    m_stateCounts[TaskRunning] = m_stateCounts[TaskFinished] = m_stateCounts[TaskFailed] = 0;
+    if (m_model) {
+        const int rowCount = m_model->rowCount();
+        m_tasks.reserve(rowCount);
+        for (int row = 0; row < rowCount; ++row) {
+            const Task task = taskFromModel(row);
+            ++m_stateCounts[task.state];
+            m_tasks.append(task);
+        }
+    }
+    tasksChanged();
+}
+
+void MultiProgressWidget::modelDestroyed()
+{
+    m_model = 0;
+    modelReset();
+}
+
+int MultiProgressWidget::rowHeight() const
+{
+    return qMax(fontMetrics().height(), BAR_HEIGHT) + 4;
+}
+
+QRect MultiProgressWidget::rowRect(int row) const
+{
+    const int height = rowHeight();
+    return QRect(0, (row + 1) * height, width(), height);
+}
+
+QSize MultiProgressWidget::sizeHint() const
+{
+    return QSize(200, rowHeight() * (m_tasks.size() + 1));
+}
+
+// Relative to the row, like m_innerRect
+QRect MultiProgressWidget::fillRect(const Task &task) const
+{
+    double range = task.maximum - task.minimum;
+    double percent = 0.;
+    if (range != 0)
+        percent = (task.value - task.minimum) / range;
+    if (percent > 1)
+        percent = 1;
+    else if (percent < 0)
+        percent = 0;
+
+    if (task.state == TaskFinished)
+        percent = 1;
+
+    QRect inner = m_innerRect;
+    inner.adjust(0, 0, qRound((percent - 1) * inner.width()), 0);
+    // avoid too small red bar
+    if (task.state == TaskFailed && inner.width() < 10)
+        inner.adjust(0, 0, 10 - inner.width(), 0);
+    return inner;
+}
+
+void MultiProgressWidget::invalidateLayout()
+{
+    m_layoutValid = false;
+    for (int row = 0; row < m_tasks.size(); ++row)
+        m_tasks[row].elidedTitle.clear();
+    update();
+}
+
+// Lays out a row and renders the frame and the full fill of each state,
+// rows blit them instead of drawing gradients
+void MultiProgressWidget::ensureLayout()
+{
+    const qreal pixelRatio = chromePixelRatio(this);
+    if (m_layoutValid && m_chromeDevicePixelRatio == pixelRatio)
+        return;
+    m_layoutValid = true;
+    m_chromeDevicePixelRatio = pixelRatio;
+
+    const int height = rowHeight();
+    const int barWidth = qMax(MIN_BAR_WIDTH, width() / 3);
+    m_titleWidth = qMax(0, width() - barWidth - 3 * INDENT);
+    m_barRect = QRect(width() - INDENT - barWidth, (height - BAR_HEIGHT) / 2, barWidth, BAR_HEIGHT - 1);
+    m_innerRect = m_barRect.adjusted(3, 2, -2, -2);
+
+    m_frame = createChromePixmap(m_barRect.size(), pixelRatio);
+    {
+        QPainter p(&m_frame);
+        Utils::StyleHelper::drawCornerImage(barImage(), &p, QRect(QPoint(0, 0), m_barRect.size()), 2, 2, 2, 2);
+    }
+
+    const QRect inner(QPoint(0, 0), m_innerRect.size());
+    for (int state = TaskRunning; state <= TaskFailed; ++state) {
+        const QColor c = stateColor(TaskState(state));
+        QPixmap &fill = m_fills[state];
+        fill = createChromePixmap(inner.size(), pixelRatio);
+        QPainter p(&fill);
+        QLinearGradient grad(inner.topLeft(), inner.bottomLeft());
+        grad.setColorAt(0, c.lighter(130));
+        grad.setColorAt(0.5, c.lighter(106));
+        grad.setColorAt(0.51, c.darker(106));
+        grad.setColorAt(1, c.darker(130));
+        p.setPen(Qt::NoPen);
+        p.setBrush(grad);
+        p.drawRect(inner);
+        p.setBrush(Qt::NoBrush);
+        p.setPen(QPen(QColor(0, 0, 0, 30), 1));
+        p.drawLine(inner.topLeft(), inner.topRight());
+        p.drawLine(inner.topLeft(), inner.bottomLeft());
+        p.drawLine(inner.bottomLeft(), inner.bottomRight());
+    }
+}
+
+void MultiProgressWidget::resizeEvent(QResizeEvent *event)
+{
+    if (event->size().width() != event->oldSize().width())
+        invalidateLayout();
+    QWidget::resizeEvent(event);
+}
+
+void MultiProgressWidget::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::FontChange || event->type() == QEvent::StyleChange) {
+        invalidateLayout();
+        updateGeometry();
+    }
+    QWidget::changeEvent(event);
+}
+
+void MultiProgressWidget::paintTask(QPainter *painter, int row)
+{
+    Task &task = m_tasks[row];
+    const QRect rect = rowRect(row);
+    if (task.elidedTitle.isEmpty())
+        task.elidedTitle = fontMetrics().elidedText(task.title, Qt::ElideRight, m_titleWidth);
+    painter->setPen(Utils::StyleHelper::panelTextColor());
+    painter->drawText(QRect(rect.left() + INDENT, rect.top(), m_titleWidth, rect.height()),
+                      Qt::AlignLeft | Qt::AlignVCenter, task.elidedTitle);
+
+    painter->drawPixmap(rect.topLeft() + m_barRect.topLeft(), m_frame);
+    const QRect inner = fillRect(task).translated(rect.topLeft());
+    // An empty source rect would mean the whole fill
+    const QPixmap &fill = m_fills[task.state];
+    if (inner.width() > 0) {
+        // the source rect is in device pixels of the fill
+        const int width = qMin(inner.width(), m_innerRect.width());
+        painter->drawPixmap(QRect(inner.topLeft(), QSize(width, inner.height())), fill,
+                            QRect(0, 0, qRound(width * m_chromeDevicePixelRatio), fill.height()));
+    }
+    // Draw line and shadow after the fill
+    if (task.state == TaskRunning && task.value > task.minimum && task.value < task.maximum) {
+        painter->fillRect(QRect(inner.right() + 1, inner.top(), 2, inner.height()), QColor(0, 0, 0, 20));
+        painter->fillRect(QRect(inner.right() + 1, inner.top(), 1, inner.height()), QColor(0, 0, 0, 60));
+    }
+    painter->setPen(QPen(QColor(0, 0, 0, 30), 1));
+    painter->drawLine(inner.topRight(), inner.bottomRight());
+}
+
+void MultiProgressWidget::paintEvent(QPaintEvent *event)
+{
+    ensureLayout();
+    QPainter p(this);
+    const QRect exposed = event->rect();
+
+    const QRect summaryRect = rowRect(-1);
+    if (exposed.intersects(summaryRect)) {
+        QFont boldFont(font());
+        boldFont.setPointSizeF(Utils::StyleHelper::sidebarFontSize());
+        boldFont.setBold(true);
+        p.setFont(boldFont);
+        p.setPen(Utils::StyleHelper::panelTextColor());
+        p.drawText(summaryRect.adjusted(INDENT, 0, -INDENT, 0), Qt::AlignLeft | Qt::AlignVCenter,
+                   tr("%1 running, %2 failed").arg(runningCount()).arg(failedCount()));
+        p.setFont(font());
+    }
+
+    // Only the rows in the exposed area
+    const int height = rowHeight();
+    const int first = qMax(0, exposed.top() / height - 1);
+    const int last = qMin(m_tasks.size() - 1, exposed.bottom() / height - 1);
+    for (int row = first; row <= last; ++row)
+        paintTask(&p, row);
+}
@@ -0,0 +1,101 @@
+#ifndef MULTIPROGRESSWIDGET_H
+#define MULTIPROGRESSWIDGET_H
+
+#include "../qt-manhattan-style_global.hpp"
+#include <QPixmap>
+#include <QVector>
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+class QAbstractItemModel;
+class QModelIndex;
+QT_END_NAMESPACE
+
+namespace Manhattan {
+
+// Shows the progress of many tasks in one widget instead of a ProgressBar
+// per task. A summary row counts running and failed tasks, below it each
+// task has a row with its title and a bar. Only the rows in the exposed
+// area are painted, from a frame and fills rendered once per bar size.
+// Put it into a QScrollArea for long lists.
+class QTMANHATTANSTYLESHARED_EXPORT MultiProgressWidget : public QWidget
+{
+    Q_OBJECT
+
+public:
+    enum TaskState { TaskRunning, TaskFinished, TaskFailed };
+    enum Roles {
+        ValueRole = Qt::UserRole + 1, // int
+        MinimumRole,                  // int, 0 when not set
+        MaximumRole,                  // int, 100 when not set
+        StateRole                     // TaskState, TaskRunning when not set
+    };
+
+    explicit MultiProgressWidget(QWidget *parent = 0);
+    ~MultiProgressWidget();
+
+    // One task per top level row of model, using column 0. The title is
+    // taken from Qt::DisplayRole, the progress from the roles above.
+    // Changes of the model only repaint the rows concerned.
+    void setModel(QAbstractItemModel *model);
+    QAbstractItemModel *model() const { return m_model; }
+
+    int taskCount() const { return m_tasks.size(); }
+    int runningCount() const { return m_stateCounts[TaskRunning]; }
+    int finishedCount() const { return m_stateCounts[TaskFinished]; }
+    int failedCount() const { return m_stateCounts[TaskFailed]; }
+
+    QSize sizeHint() const;
+
+private slots:
+    void modelRowsInserted(const QModelIndex &parent, int first, int last);
+    void modelRowsRemoved(const QModelIndex &parent, int first, int last);
+    void modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void modelReset();
+    void modelDestroyed();
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void changeEvent(QEvent *event);
+
+private:
+    struct Task {
+        QString title;
+        // empty until the row is painted, cleared when the width changes
+        QString elidedTitle;
+        int minimum;
+        int maximum;
+        int value;
+        TaskState state;
+    };
+    Task taskFromModel(int row) const;
+    void setTask(int row, const Task &task);
+    void tasksChanged();
+
+    int rowHeight() const;
+    // The summary is row -1
+    QRect rowRect(int row) const;
+    QRect fillRect(const Task &task) const;
+    void invalidateLayout();
+    void ensureLayout();
+    void paintTask(QPainter *painter, int row);
+
+    QAbstractItemModel *m_model;
+    QVector<Task> m_tasks;
+    int m_stateCounts[3];
+
+    // Cached layout, see ensureLayout()
+    bool m_layoutValid;
+    int m_titleWidth;
+    QRect m_barRect;
+    QRect m_innerRect;
+    // rendered at m_chromeDevicePixelRatio
+    QPixmap m_frame;
+    QPixmap m_fills[3];
+    qreal m_chromeDevicePixelRatio;
+};
+
+} // namespace Manhattan
+
+#endif // MULTIPROGRESSWIDGET_H
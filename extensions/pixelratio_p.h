@@ -0,0 +1,37 @@
+#ifndef PIXELRATIO_P_H
+#define PIXELRATIO_P_H
+
+#include <QPixmap>
+#include <QWidget>
+
+// Helpers for the pixmaps widgets cache their chrome in, not exported
+
+namespace Manhattan {
+
+// The ratio cached chrome pixmaps are rendered at, so they stay sharp
+inline qreal chromePixelRatio(const QWidget *widget)
+{
+#if QT_VERSION >= 0x050600
+    return widget->devicePixelRatioF();
+#elif QT_VERSION >= 0x050000
+    return widget->devicePixelRatio();
+#else
+    Q_UNUSED(widget)
+    return 1;
+#endif
+}
+
+// A transparent pixmap of size in logical pixels, at pixelRatio
+inline QPixmap createChromePixmap(const QSize &size, qreal pixelRatio)
+{
+    QPixmap pixmap(size * pixelRatio);
+#if QT_VERSION >= 0x050000
+    pixmap.setDevicePixelRatio(pixelRatio);
+#endif
+    pixmap.fill(Qt::transparent);
+    return pixmap;
+}
+
+} // namespace Manhattan
+
+#endif // PIXELRATIO_P_H
@@ -0,0 +1,81 @@
+#include "progresssink.h"
+
+using namespace Manhattan;
+
+static inline quint64 packRange(int minimum, int maximum)
+{
+    return (quint64(quint32(minimum)) << 32) | quint32(maximum);
+}
+
+ProgressSink::ProgressSink() :
+    m_value(1),
+    m_range(packRange(1, 100)),
+    m_writeCount(0)
+{
+}
+
+void ProgressSink::setRange(int minimum, int maximum)
+{
+    m_range.storeRelease(packRange(minimum, maximum));
+    m_writeCount.fetchAndAddRelease(1);
+}
+
+void ProgressSink::setValue(int value)
+{
+    m_value.storeRelease(value);
+    m_writeCount.fetchAndAddRelease(1);
+}
+
+int ProgressSink::value() const
+{
+    return m_value.loadAcquire();
+}
+
+void ProgressSink::read(int *minimum, int *maximum, int *value) const
+{
+    const quint64 range = m_range.loadAcquire();
+    *minimum = int(quint32(range >> 32));
+    *maximum = int(quint32(range));
+    *value = m_value.loadAcquire();
+}
+
+int ProgressSink::writeCount() const
+{
+    return m_writeCount.loadAcquire();
+}
+
+ProgressSink::Sampler::Sampler() :
+    m_sink(0),
+    m_writeCount(0),
+    m_coalescedUpdates(0),
+    m_droppedUpdates(0)
+{
+}
+
+void ProgressSink::Sampler::setSink(ProgressSink *sink, QObject *owner)
+{
+    m_sink = sink;
+    if (!m_sink) {
+        m_timer.stop();
+        return;
+    }
+    m_writeCount = m_sink->writeCount() - 1;
+    m_timer.start(SampleInterval, owner);
+}
+
+bool ProgressSink::Sampler::sample(int *minimum, int *maximum, int *value)
+{
+    if (!m_sink)
+        return false;
+    const int writeCount = m_sink->writeCount();
+    const int writes = int(uint(writeCount) - uint(m_writeCount));
+    if (!writes)
+        return false;
+    m_writeCount = writeCount;
+    m_coalescedUpdates += writes - 1;
+    m_sink->read(minimum, maximum, value);
+    // finished, nothing to wait for any more; a busy range never is
+    if (*maximum > *minimum && *value >= *maximum)
+        m_timer.stop();
+    return true;
+}
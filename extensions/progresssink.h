@@ -0,0 +1,82 @@
+#ifndef PROGRESSSINK_H
+#define PROGRESSSINK_H
+
+#include "../qt-manhattan-style_global.hpp"
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QBasicTimer>
+
+QT_BEGIN_NAMESPACE
+class QObject;
+QT_END_NAMESPACE
+
+namespace Manhattan {
+
+// Progress that worker threads write directly instead of signalling every
+// step to the GUI thread. Every write is a single atomic store: the value
+// is one atomic, the range is packed into another. A ProgressBar or
+// SimpleProgressBar given the sink with setProgressSink() samples it once
+// per frame, so any number of writes costs at most one repaint.
+class QTMANHATTANSTYLESHARED_EXPORT ProgressSink
+{
+public:
+    // How often widgets sample a sink, in milliseconds
+    static const int SampleInterval = 40;
+
+    ProgressSink();
+
+    void setRange(int minimum, int maximum);
+    void setValue(int value);
+
+    int value() const;
+    // Reads the range and value, the range is never half updated
+    void read(int *minimum, int *maximum, int *value) const;
+    // How often setRange() and setValue() were called, wraps around
+    int writeCount() const;
+
+    // The widget side: samples a sink on a timer of the widget and keeps
+    // track of writes merged into one frame and of values that did not
+    // change the bar.
+    class QTMANHATTANSTYLESHARED_EXPORT Sampler
+    {
+    public:
+        Sampler();
+
+        // Starts the timer on owner, 0 stops it. The next sample() after
+        // setting a sink always returns true. The timer stops by itself once
+        // the value sampled reached the maximum, a sink written again after
+        // that has to be set again.
+        void setSink(ProgressSink *sink, QObject *owner);
+        ProgressSink *sink() const { return m_sink; }
+        int timerId() const { return m_timer.timerId(); }
+
+        // Returns false when nothing was written since the last sample
+        bool sample(int *minimum, int *maximum, int *value);
+        // For the widget to report a sampled value it did not repaint for
+        void addDroppedUpdate() { ++m_droppedUpdates; }
+
+        // Writes to the sink that were merged into a later frame
+        int coalescedUpdates() const { return m_coalescedUpdates; }
+        // Sampled values that did not change the bar by a pixel
+        int droppedUpdates() const { return m_droppedUpdates; }
+
+    private:
+        ProgressSink *m_sink;
+        QBasicTimer m_timer;
+        int m_writeCount;
+        int m_coalescedUpdates;
+        int m_droppedUpdates;
+    };
+
+private:
+    Q_DISABLE_COPY(ProgressSink)
+
+    QAtomicInt m_value;
+    // minimum in the high, maximum in the low 32 bits
+    QAtomicInteger<quint64> m_range;
+    QAtomicInt m_writeCount;
+};
+
+} // namespace Manhattan
+
+#endif // PROGRESSSINK_H
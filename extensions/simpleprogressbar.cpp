@@ -4,6 +4,7 @@
 #include <QPainter>
 #include <QBrush>
 #include <QColor>
+#include <QTimerEvent>
 
 using namespace Manhattan;
 
@@ -48,8 +49,42 @@ void SimpleProgressBar::setValue(int value)
             || m_value > m_maximum) {
         return;
     }
+    // Only repaint when the bar changes by at least a pixel
+    const QRect oldFill = fillRect();
+    const bool wasRunning = isRunning();
     m_value = value;
-    update();
+    if (fillRect() != oldFill || isRunning() != wasRunning)
+        update();
+}
+
+void SimpleProgressBar::setProgressSink(ProgressSink *sink)
+{
+    m_sampler.setSink(sink, this);
+    sampleProgressSink();
+}
+
+void SimpleProgressBar::sampleProgressSink()
+{
+    int minimum;
+    int maximum;
+    int value;
+    if (!m_sampler.sample(&minimum, &maximum, &value))
+        return;
+    if (minimum != m_minimum || maximum != m_maximum)
+        setRange(minimum, maximum);
+    const QRect oldFill = fillRect();
+    const int oldValue = m_value;
+    setValue(value);
+    if (m_value != oldValue && fillRect() == oldFill)
+        m_sampler.addDroppedUpdate();
+}
+
+void SimpleProgressBar::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_sampler.timerId())
+        sampleProgressSink();
+    else
+        QWidget::timerEvent(event);
 }
 
 void SimpleProgressBar::setFinished(bool b)
@@ -79,11 +114,13 @@ QSize SimpleProgressBar::sizeHint() const
     return s;
 }
 
-void SimpleProgressBar::paintEvent(QPaintEvent *)
+QRect SimpleProgressBar::barRect() const
 {
-    if (bar.isNull())
-        bar.load(QLatin1String(":/core/images/progressbar.png"));
+    return QRect((size().width() - m_progressWidth) / 2, (size().height() - m_progressHeight) / 2, m_progressWidth, m_progressHeight-1);
+}
 
+QRect SimpleProgressBar::fillRect() const
+{
     double range = maximum() - minimum();
     double percent = 0.;
     if (range != 0)
@@ -96,10 +133,23 @@ void SimpleProgressBar::paintEvent(QPaintEvent *)
     if (finished())
         percent = 1;
 
+    QRect inner = barRect().adjusted(3, 2, -2, -2);
+    inner.adjust(0, 0, qRound((percent - 1) * inner.width()), 0);
+    // avoid too small red bar
+    if (m_error && inner.width() < 10)
+        inner.adjust(0, 0, 10 - inner.width(), 0);
+    return inner;
+}
+
+void SimpleProgressBar::paintEvent(QPaintEvent *)
+{
+    if (bar.isNull())
+        bar.load(QLatin1String(":/core/images/progressbar.png"));
+
     QPainter p(this);
 
     // draw outer rect
-    QRect rect((size().width() - m_progressWidth) / 2, (size().height() - m_progressHeight) / 2, m_progressWidth, m_progressHeight-1);
+    QRect rect = barRect();
     p.setPen(Utils::StyleHelper::panelTextColor());
     Utils::StyleHelper::drawCornerImage(bar, &p, rect, 2, 2, 2, 2);
 
@@ -108,14 +158,10 @@ void SimpleProgressBar::paintEvent(QPaintEvent *)
     c.setAlpha(180);
     p.setPen(Qt::NoPen);
 
-    QRect inner = rect.adjusted(3, 2, -2, -2);
-    inner.adjust(0, 0, qRound((percent - 1) * inner.width()), 0);
+    QRect inner = fillRect();
     if (m_error) {
         QColor red(255, 60, 0, 210);
         c = red;
-        // avoid too small red bar
-        if (inner.width() < 10)
-            inner.adjust(0, 0, 10 - inner.width(), 0);
     } else if (m_finished) {
         c = QColor(90, 170, 60);
     }
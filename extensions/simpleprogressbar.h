@@ -2,6 +2,7 @@
 #define SIMPLEPROGRESSBAR_H
 
 #include "../qt-manhattan-style_global.hpp"
+#include "progresssink.h"
 #include <QWidget>
 
 namespace Manhattan {
@@ -26,10 +27,26 @@ public:
     void setValue(int value);
     void setFinished(bool b);
 
+    // Samples sink once per frame instead of taking every value written
+    // to it. Pass 0 to stop, the sink must outlive the bar otherwise.
+    void setProgressSink(ProgressSink *sink);
+    ProgressSink *progressSink() const { return m_sampler.sink(); }
+    // See ProgressSink::Sampler
+    int coalescedUpdates() const { return m_sampler.coalescedUpdates(); }
+    int droppedUpdates() const { return m_sampler.droppedUpdates(); }
+
 public slots:
     void reset();
 
+protected:
+    void timerEvent(QTimerEvent *event);
+
 private:
+    QRect barRect() const;
+    QRect fillRect() const;
+    bool isRunning() const { return m_value > 0 && m_value < m_maximum; }
+    void sampleProgressSink();
+
     QImage bar;
     QString m_text;
     bool m_error;
@@ -39,6 +56,7 @@ private:
     int m_maximum;
     int m_value;
     bool m_finished;
+    ProgressSink::Sampler m_sampler;
 };
 
 } // namespace Manhattan
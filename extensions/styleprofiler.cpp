@@ -0,0 +1,304 @@
+#include "styleprofiler.h"
+
+#include <QHash>
+#include <QMetaEnum>
+#include <QMutex>
+#include <QPainter>
+#include <QStyle>
+#include <QThread>
+#include <QTimerEvent>
+#include <QVector>
+
+using namespace Manhattan;
+
+// Four buckets per power of two
+static const int HISTOGRAM_SIZE = 256;
+static const int OVERLAY_LINES = 12;
+static const int OVERLAY_INTERVAL = 1000;
+// The QStyle enum of each Kind
+static const char * const kindEnumNames[] = { "PrimitiveElement", "ControlElement", "ComplexControl" };
+
+bool StyleProfiler::m_enabled = false;
+
+namespace {
+
+struct ProfileKey {
+    int kind;
+    int element;
+    const char *className;
+};
+
+inline bool operator==(const ProfileKey &a, const ProfileKey &b)
+{
+    return a.kind == b.kind && a.element == b.element && a.className == b.className;
+}
+
+inline uint qHash(const ProfileKey &key)
+{
+    return ::qHash(quintptr(key.className)) ^ uint(key.kind << 24) ^ uint(key.element);
+}
+
+struct Histogram {
+    Histogram() : count(0), totalTime(0), maximum(0), buckets(HISTOGRAM_SIZE, 0) {}
+
+    void add(const Histogram &other);
+
+    int count;
+    qint64 totalTime;
+    qint64 maximum;
+    QVector<quint32> buckets;
+};
+
+struct ProfileData {
+    QMutex mutex;
+    QHash<ProfileKey, Histogram> histograms;
+};
+
+} // anonymous namespace
+
+static ProfileData &profileData()
+{
+    static ProfileData data;
+    return data;
+}
+
+void Histogram::add(const Histogram &other)
+{
+    count += other.count;
+    totalTime += other.totalTime;
+    maximum = qMax(maximum, other.maximum);
+    for (int i = 0; i < HISTOGRAM_SIZE; ++i)
+        buckets[i] += other.buckets.at(i);
+}
+
+static int bucketOf(qint64 time)
+{
+    if (time < 4)
+        return int(qMax(time, qint64(0)));
+    int log = 0;
+    for (quint64 v = time; v >>= 1; )
+        ++log;
+    return log * 4 + int((time >> (log - 2)) & 3);
+}
+
+// The upper end of a bucket
+static qint64 bucketLimit(int bucket)
+{
+    if (bucket < 4)
+        return bucket;
+    const int log = bucket / 4;
+    return (qint64(5 + bucket % 4) << (log - 2)) - 1;
+}
+
+static qint64 percentile(const Histogram &histogram, double fraction)
+{
+    const qint64 wanted = qint64(fraction * histogram.count);
+    qint64 seen = 0;
+    for (int i = 0; i < HISTOGRAM_SIZE; ++i) {
+        seen += histogram.buckets.at(i);
+        if (seen > wanted)
+            return qMin(bucketLimit(i), histogram.maximum);
+    }
+    return histogram.maximum;
+}
+
+static QString elementName(int kind, int element)
+{
+    const QMetaObject &metaObject = QStyle::staticMetaObject;
+    const int index = metaObject.indexOfEnumerator(kindEnumNames[kind]);
+    if (index >= 0) {
+        if (const char *key = metaObject.enumerator(index).valueToKey(element))
+            return QLatin1String(key);
+    }
+    return QString::fromLatin1("%1 %2").arg(QLatin1String(kindEnumNames[kind])).arg(element);
+}
+
+static QList<StyleProfiler::Statistics> statistics(bool byElement)
+{
+    QHash<QString, Histogram> merged;
+    {
+        ProfileData &data = profileData();
+        QMutexLocker locker(&data.mutex);
+        QHash<ProfileKey, Histogram>::const_iterator it = data.histograms.constBegin();
+        for ( ; it != data.histograms.constEnd(); ++it) {
+            const ProfileKey &key = it.key();
+            const QString name = byElement ? elementName(key.kind, key.element)
+                                           : QLatin1String(key.className);
+            merged[name].add(it.value());
+        }
+    }
+
+    QList<StyleProfiler::Statistics> result;
+    QHash<QString, Histogram>::const_iterator it = merged.constBegin();
+    for ( ; it != merged.constEnd(); ++it) {
+        const Histogram &histogram = it.value();
+        StyleProfiler::Statistics statistics;
+        statistics.name = it.key();
+        statistics.count = histogram.count;
+        statistics.totalTime = histogram.totalTime;
+        statistics.median = percentile(histogram, 0.5);
+        statistics.percentile90 = percentile(histogram, 0.9);
+        statistics.percentile99 = percentile(histogram, 0.99);
+        statistics.maximum = histogram.maximum;
+        result.append(statistics);
+    }
+    return result;
+}
+
+static bool moreTotalTime(const StyleProfiler::Statistics &a, const StyleProfiler::Statistics &b)
+{
+    return a.totalTime > b.totalTime;
+}
+
+void StyleProfiler::setEnabled(bool enabled)
+{
+    m_enabled = enabled;
+}
+
+void StyleProfiler::reset()
+{
+    ProfileData &data = profileData();
+    QMutexLocker locker(&data.mutex);
+    data.histograms.clear();
+}
+
+QList<StyleProfiler::Statistics> StyleProfiler::elementStatistics()
+{
+    QList<Statistics> result = statistics(true);
+    qSort(result.begin(), result.end(), moreTotalTime);
+    return result;
+}
+
+QList<StyleProfiler::Statistics> StyleProfiler::widgetClassStatistics()
+{
+    QList<Statistics> result = statistics(false);
+    qSort(result.begin(), result.end(), moreTotalTime);
+    return result;
+}
+
+static QString formatTable(const QString &title, const QList<StyleProfiler::Statistics> &rows)
+{
+    QString table = QString::fromLatin1("%1\n%2 %3 %4 %5 %6 %7 %8\n")
+            .arg(title)
+            .arg(QLatin1String("name"), -28).arg(QLatin1String("count"), 8)
+            .arg(QLatin1String("total ms"), 10).arg(QLatin1String("p50 us"), 8)
+            .arg(QLatin1String("p90 us"), 8).arg(QLatin1String("p99 us"), 8)
+            .arg(QLatin1String("max us"), 8);
+    foreach (const StyleProfiler::Statistics &row, rows) {
+        table += QString::fromLatin1("%1 %2 %3 %4 %5 %6 %7\n")
+                .arg(row.name, -28).arg(row.count, 8)
+                .arg(row.totalTime / 1e6, 10, 'f', 2).arg(row.median / 1e3, 8, 'f', 1)
+                .arg(row.percentile90 / 1e3, 8, 'f', 1).arg(row.percentile99 / 1e3, 8, 'f', 1)
+                .arg(row.maximum / 1e3, 8, 'f', 1);
+    }
+    return table;
+}
+
+QString StyleProfiler::dump()
+{
+    return formatTable(QLatin1String("Style elements"), elementStatistics())
+            + QLatin1Char('\n')
+            + formatTable(QLatin1String("Widget classes"), widgetClassStatistics());
+}
+
+static QByteArray jsonArray(const QList<StyleProfiler::Statistics> &rows)
+{
+    QByteArray json = "[";
+    for (int i = 0; i < rows.size(); ++i) {
+        const StyleProfiler::Statistics &row = rows.at(i);
+        if (i)
+            json += ',';
+        // element and class names are identifiers, nothing to escape
+        json += "{\"name\":\"" + row.name.toLatin1()
+                + "\",\"count\":" + QByteArray::number(row.count)
+                + ",\"totalNs\":" + QByteArray::number(row.totalTime)
+                + ",\"p50Ns\":" + QByteArray::number(row.median)
+                + ",\"p90Ns\":" + QByteArray::number(row.percentile90)
+                + ",\"p99Ns\":" + QByteArray::number(row.percentile99)
+                + ",\"maxNs\":" + QByteArray::number(row.maximum) + '}';
+    }
+    json += ']';
+    return json;
+}
+
+QByteArray StyleProfiler::toJson()
+{
+    return "{\"elements\":" + jsonArray(elementStatistics())
+            + ",\"widgetClasses\":" + jsonArray(widgetClassStatistics()) + '}';
+}
+
+void StyleProfiler::Scope::begin(Kind kind, int element, const QWidget *widget)
+{
+    m_kind = kind;
+    m_element = element;
+    m_widget = widget;
+    m_timer.start();
+}
+
+void StyleProfiler::Scope::end()
+{
+    const qint64 time = m_timer.nsecsElapsed();
+    const char *className = m_widget ? m_widget->metaObject()->className() : 0;
+    if (StyleTrace::isEnabled()) {
+        const StyleTrace::Event event = {
+            "style", kindEnumNames[m_kind], m_element, className, m_widget,
+            quintptr(QThread::currentThreadId()), StyleTrace::now() - time, time,
+            StyleTrace::NoCache
+        };
+        StyleTrace::record(event);
+    }
+    if (!m_enabled)
+        return;
+    const ProfileKey key = { m_kind, m_element, className ? className : "(none)" };
+    ProfileData &data = profileData();
+    QMutexLocker locker(&data.mutex);
+    Histogram &histogram = data.histograms[key];
+    ++histogram.count;
+    histogram.totalTime += time;
+    histogram.maximum = qMax(histogram.maximum, time);
+    ++histogram.buckets[qMin(bucketOf(time), HISTOGRAM_SIZE - 1)];
+}
+
+StyleProfilerOverlay::StyleProfilerOverlay(QWidget *parent) :
+    QWidget(parent)
+{
+    setAttribute(Qt::WA_TransparentForMouseEvents);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    m_timer.start(OVERLAY_INTERVAL, this);
+    move(0, 0);
+    resize(0, 0);
+}
+
+void StyleProfilerOverlay::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() != m_timer.timerId()) {
+        QWidget::timerEvent(event);
+        return;
+    }
+    m_lines.clear();
+    const QList<StyleProfiler::Statistics> rows = StyleProfiler::elementStatistics();
+    for (int i = 0; i < rows.size() && i < OVERLAY_LINES; ++i) {
+        const StyleProfiler::Statistics &row = rows.at(i);
+        m_lines << QString::fromLatin1("%1  %2 ms  p99 %3 us")
+                   .arg(row.name).arg(row.totalTime / 1e6, 0, 'f', 1)
+                   .arg(row.percentile99 / 1e3, 0, 'f', 1);
+    }
+    // Only the box of the overlay is painted over, so little else repaints
+    const QFontMetrics fm = fontMetrics();
+    int width = 0;
+    foreach (const QString &line, m_lines)
+        width = qMax(width, fm.width(line));
+    resize(width + 8, m_lines.size() * fm.height() + 8);
+    raise();
+    update();
+}
+
+void StyleProfilerOverlay::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+    p.fillRect(rect(), Qt::black);
+    p.setPen(Qt::white);
+    const QFontMetrics fm = fontMetrics();
+    for (int i = 0; i < m_lines.size(); ++i)
+        p.drawText(4, 4 + i * fm.height() + fm.ascent(), m_lines.at(i));
+}
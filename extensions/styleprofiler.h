@@ -0,0 +1,97 @@
+#ifndef STYLEPROFILER_H
+#define STYLEPROFILER_H
+
+#include "../qt-manhattan-style_global.hpp"
+#include "styletrace.h"
+#include <QBasicTimer>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QWidget>
+
+namespace Manhattan {
+
+// Measures the time ManhattanStyle spends per primitive element, control
+// element and complex control, and per widget class. Off by default; turn
+// it on with setEnabled() or by setting MANHATTAN_STYLE_PROFILE before the
+// style is created. When off, a draw call only checks a flag.
+// Times include nested draw calls, a complex control includes the
+// primitives it draws. Draw calls are also recorded to StyleTrace when
+// it is on.
+class QTMANHATTANSTYLESHARED_EXPORT StyleProfiler
+{
+public:
+    enum Kind { Primitive, Control, ComplexControl };
+
+    struct Statistics {
+        QString name;
+        int count;
+        // in nanoseconds, the percentiles are accurate to about 20%
+        qint64 totalTime;
+        qint64 median;
+        qint64 percentile90;
+        qint64 percentile99;
+        qint64 maximum;
+    };
+
+    static bool isEnabled() { return m_enabled; }
+    static void setEnabled(bool enabled);
+    static void reset();
+
+    // Sorted by total time, most expensive first
+    static QList<Statistics> elementStatistics();
+    static QList<Statistics> widgetClassStatistics();
+    // A table of both, for logs
+    static QString dump();
+    static QByteArray toJson();
+
+    // Times a draw call from construction to destruction
+    class Scope
+    {
+    public:
+        Scope(Kind kind, int element, const QWidget *widget)
+            : m_active(m_enabled || StyleTrace::isEnabled())
+        {
+            if (m_active)
+                begin(kind, element, widget);
+        }
+        ~Scope()
+        {
+            if (m_active)
+                end();
+        }
+
+    private:
+        void begin(Kind kind, int element, const QWidget *widget);
+        void end();
+
+        bool m_active;
+        Kind m_kind;
+        int m_element;
+        const QWidget *m_widget;
+        QElapsedTimer m_timer;
+    };
+
+private:
+    static bool m_enabled;
+};
+
+// Shows the most expensive elements over its parent, refreshed every second
+class QTMANHATTANSTYLESHARED_EXPORT StyleProfilerOverlay : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit StyleProfilerOverlay(QWidget *parent);
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void timerEvent(QTimerEvent *event);
+
+private:
+    QBasicTimer m_timer;
+    QStringList m_lines;
+};
+
+} // namespace Manhattan
+
+#endif // STYLEPROFILER_H
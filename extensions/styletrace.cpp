@@ -0,0 +1,168 @@
+#include "styletrace.h"
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMetaEnum>
+#include <QStyle>
+#include <QThread>
+#include <QWidget>
+
+#include <atomic>
+
+using namespace Manhattan;
+
+bool StyleTrace::m_enabled = false;
+
+namespace {
+
+// A sequence lock per slot. serial is twice the index of the event in the
+// slot plus one, with the lowest bit set while a writer owns the slot.
+struct TraceSlot {
+    QAtomicInt serial;
+    StyleTrace::Event event;
+};
+
+} // anonymous namespace
+
+static TraceSlot traceSlots[StyleTrace::Capacity];
+static QAtomicInt traceWriteIndex;
+static QAtomicInt traceStartIndex;
+static QAtomicInt traceDroppedCount;
+
+static inline int stableSerial(uint index)
+{
+    return int((index + 1) << 1);
+}
+
+static QElapsedTimer startedClock()
+{
+    QElapsedTimer clock;
+    clock.start();
+    return clock;
+}
+
+static const QElapsedTimer &traceClock()
+{
+    static const QElapsedTimer clock = startedClock();
+    return clock;
+}
+
+void StyleTrace::setEnabled(bool enabled)
+{
+    traceClock();
+    m_enabled = enabled;
+}
+
+qint64 StyleTrace::now()
+{
+    return traceClock().nsecsElapsed();
+}
+
+void StyleTrace::record(const Event &event)
+{
+    const uint index = uint(traceWriteIndex.fetchAndAddRelaxed(1));
+    TraceSlot &slot = traceSlots[index % Capacity];
+    const int mine = stableSerial(index);
+    // A writer wrapped around from Capacity events earlier or later may
+    // own the slot, or may have stored a newer event. Drop this event
+    // then instead of waiting for it.
+    const int current = slot.serial.load();
+    if ((current & 1) || int(uint(current) - uint(mine)) > 0
+            || !slot.serial.testAndSetRelaxed(current, mine | 1)) {
+        traceDroppedCount.fetchAndAddRelaxed(1);
+        return;
+    }
+    // the event must not become visible before the slot is marked busy
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.serial.storeRelease(mine);
+}
+
+QList<StyleTrace::Event> StyleTrace::events()
+{
+    QList<Event> result;
+    // indexes wrap around, so they are compared by distance
+    const uint end = uint(traceWriteIndex.loadAcquire());
+    uint begin = uint(traceStartIndex.loadAcquire());
+    if (end - begin > uint(Capacity))
+        begin = end - Capacity;
+    for (uint index = begin; index != end; ++index) {
+        const TraceSlot &slot = traceSlots[index % Capacity];
+        const int serial = stableSerial(index);
+        if (slot.serial.loadAcquire() != serial)
+            continue;
+        const Event event = slot.event;
+        // the copy must be complete before the serial is checked again,
+        // it is dropped when the slot was written meanwhile
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.serial.load() == serial)
+            result.append(event);
+    }
+    return result;
+}
+
+int StyleTrace::droppedCount()
+{
+    return traceDroppedCount.load();
+}
+
+void StyleTrace::clear()
+{
+    traceStartIndex.storeRelease(traceWriteIndex.loadAcquire());
+}
+
+static QByteArray eventName(const StyleTrace::Event &event)
+{
+    if (event.element >= 0) {
+        const QMetaObject &metaObject = QStyle::staticMetaObject;
+        const int index = metaObject.indexOfEnumerator(event.name);
+        if (index >= 0) {
+            if (const char *key = metaObject.enumerator(index).valueToKey(event.element))
+                return key;
+        }
+        return QByteArray(event.name) + ' ' + QByteArray::number(event.element);
+    }
+    return event.name;
+}
+
+QByteArray StyleTrace::toChromeTraceJson()
+{
+    static const char * const cacheResults[] = { "none", "hit", "miss" };
+    QByteArray json = "{\"traceEvents\":[";
+    const QList<Event> recorded = events();
+    for (int i = 0; i < recorded.size(); ++i) {
+        const Event &event = recorded.at(i);
+        if (i)
+            json += ",\n";
+        // names are identifiers and literals, nothing to escape
+        json += "{\"name\":\"" + eventName(event)
+                + "\",\"cat\":\"" + event.category
+                + "\",\"ph\":\"X\",\"ts\":" + QByteArray::number(event.start / 1e3, 'f', 3)
+                + ",\"dur\":" + QByteArray::number(event.duration / 1e3, 'f', 3)
+                + ",\"pid\":1,\"tid\":" + QByteArray::number(quint64(event.thread))
+                + ",\"args\":{\"widget\":\"0x" + QByteArray::number(quint64(quintptr(event.widget)), 16)
+                + "\",\"class\":\"" + (event.className ? event.className : "")
+                + "\",\"cache\":\"" + cacheResults[event.cacheResult] + "\"}}";
+    }
+    json += "],\"displayTimeUnit\":\"ns\"}";
+    return json;
+}
+
+void StyleTrace::Scope::begin(const char *category, const char *name, int element,
+                              const QWidget *widget, CacheResult cacheResult)
+{
+    m_event.category = category;
+    m_event.name = name;
+    m_event.element = element;
+    m_event.className = widget ? widget->metaObject()->className() : 0;
+    m_event.widget = widget;
+    m_event.thread = quintptr(QThread::currentThreadId());
+    m_event.cacheResult = cacheResult;
+    m_event.start = now();
+}
+
+void StyleTrace::Scope::end()
+{
+    m_event.duration = now() - m_event.start;
+    record(m_event);
+}
@@ -0,0 +1,92 @@
+#ifndef STYLETRACE_H
+#define STYLETRACE_H
+
+#include "../qt-manhattan-style_global.hpp"
+#include <QList>
+
+QT_BEGIN_NAMESPACE
+class QWidget;
+QT_END_NAMESPACE
+
+namespace Manhattan {
+
+// A fixed size ring buffer of the latest style work: draw calls of
+// ManhattanStyle, StyleAnimator ticks and StyleHelper drawing backed by
+// the pixmap cache. Events of the "cache" category time the whole draw,
+// including the rendering of the pixmap on a miss, and record whether
+// the lookup hit.
+// Recording takes no lock, so it can stay on in the field and be dumped
+// when a hitch is reported, see toChromeTraceJson(). Off by default; turn
+// it on with setEnabled() or by setting MANHATTAN_STYLE_TRACE before the
+// style is created.
+class QTMANHATTANSTYLESHARED_EXPORT StyleTrace
+{
+public:
+    enum CacheResult { NoCache, CacheHit, CacheMiss };
+
+    struct Event {
+        // static strings, the name of a draw call is the QStyle enum of
+        // element, for other events element is -1
+        const char *category;
+        const char *name;
+        int element;
+        const char *className;
+        const void *widget;
+        quintptr thread;
+        // in nanoseconds, start since the first event
+        qint64 start;
+        qint64 duration;
+        CacheResult cacheResult;
+    };
+
+    // How many of the latest events are kept
+    static const int Capacity = 4096;
+
+    static bool isEnabled() { return m_enabled; }
+    static void setEnabled(bool enabled);
+
+    static qint64 now();
+    static void record(const Event &event);
+    // The kept events, oldest first
+    static QList<Event> events();
+    // Events not recorded because a writer a whole buffer ahead or behind
+    // held their slot
+    static int droppedCount();
+    static void clear();
+    // In the trace event format of chrome://tracing and Perfetto
+    static QByteArray toChromeTraceJson();
+
+    // Records the time from construction to destruction
+    class Scope
+    {
+    public:
+        Scope(const char *category, const char *name, int element = -1,
+              const QWidget *widget = 0, CacheResult cacheResult = NoCache)
+            : m_active(m_enabled)
+        {
+            if (m_active)
+                begin(category, name, element, widget, cacheResult);
+        }
+        ~Scope()
+        {
+            if (m_active)
+                end();
+        }
+        void setCacheResult(CacheResult cacheResult) { m_event.cacheResult = cacheResult; }
+
+    private:
+        void begin(const char *category, const char *name, int element,
+                   const QWidget *widget, CacheResult cacheResult);
+        void end();
+
+        bool m_active;
+        Event m_event;
+    };
+
+private:
+    static bool m_enabled;
+};
+
+} // namespace Manhattan
+
+#endif // STYLETRACE_H
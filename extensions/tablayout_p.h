@@ -0,0 +1,21 @@
+#ifndef TABLAYOUT_P_H
+#define TABLAYOUT_P_H
+
+#include <QVector>
+#include <QtAlgorithms>
+
+// Helpers shared by DoubleTabWidget and TabWidget, not exported
+
+namespace Manhattan {
+
+// Returns how many leading tabs end before width, given their start offsets
+inline int fittingTabs(const QVector<int> &tabOffsets, int width)
+{
+    const QVector<int>::const_iterator begin = tabOffsets.constBegin();
+    const int count = qLowerBound(begin, tabOffsets.constEnd(), width) - begin - 1;
+    return qMax(count, 0);
+}
+
+} // namespace Manhattan
+
+#endif // TABLAYOUT_P_H
@@ -0,0 +1,164 @@
+#include "taboverflowpopup.h"
+#include <QApplication>
+#include <QDesktopWidget>
+#include <QKeyEvent>
+#include <QLineEdit>
+#include <QListView>
+#include <QSortFilterProxyModel>
+#include <QStringListModel>
+#include <QVBoxLayout>
+
+using namespace Manhattan;
+
+static const int POPUP_WIDTH = 250;
+static const int MAX_VISIBLE_ROWS = 20;
+
+namespace Manhattan {
+
+// Hides the tabs that are shown in the tab bar, on top of the text filter
+class TabOverflowFilter : public QSortFilterProxyModel
+{
+public:
+    explicit TabOverflowFilter(QObject *parent) :
+        QSortFilterProxyModel(parent), m_firstRow(0), m_skippedRow(-1) {}
+
+    void setRows(int firstRow, int skippedRow)
+    {
+        if (firstRow == m_firstRow && skippedRow == m_skippedRow)
+            return;
+        m_firstRow = firstRow;
+        m_skippedRow = skippedRow;
+        invalidateFilter();
+    }
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+    {
+        if (sourceRow < m_firstRow || sourceRow == m_skippedRow)
+            return false;
+        return QSortFilterProxyModel::filterAcceptsRow(sourceRow, sourceParent);
+    }
+
+private:
+    int m_firstRow;
+    int m_skippedRow;
+};
+
+} // namespace Manhattan
+
+TabOverflowPopup::TabOverflowPopup(QWidget *parent) :
+    QFrame(parent, Qt::Popup),
+    m_filter(new QLineEdit),
+    m_view(new QListView),
+    m_model(new QStringListModel(this)),
+    m_proxy(new TabOverflowFilter(this))
+{
+    setFrameStyle(QFrame::StyledPanel | QFrame::Plain);
+
+    m_proxy->setSourceModel(m_model);
+    m_proxy->setFilterCaseSensitivity(Qt::CaseInsensitive);
+
+    // Uniform item sizes keep the view fast with many entries
+    m_view->setModel(m_proxy);
+    m_view->setUniformItemSizes(true);
+    m_view->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_view->setFocusPolicy(Qt::NoFocus);
+    m_view->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+
+    // The filter keeps the focus, navigation keys are forwarded to the view
+    m_filter->installEventFilter(this);
+
+    QVBoxLayout *layout = new QVBoxLayout;
+    layout->setContentsMargins(1, 1, 1, 1);
+    layout->setSpacing(1);
+    layout->addWidget(m_filter);
+    layout->addWidget(m_view);
+    setLayout(layout);
+
+    connect(m_filter, SIGNAL(textChanged(QString)), this, SLOT(filterChanged(QString)));
+    connect(m_view, SIGNAL(clicked(QModelIndex)), this, SLOT(activate(QModelIndex)));
+}
+
+void TabOverflowPopup::setTabNames(const QStringList &names)
+{
+    m_model->setStringList(names);
+}
+
+void TabOverflowPopup::insertTab(int index, const QString &name)
+{
+    m_model->insertRow(index);
+    m_model->setData(m_model->index(index), name);
+}
+
+void TabOverflowPopup::removeTab(int index)
+{
+    m_model->removeRow(index);
+}
+
+void TabOverflowPopup::setTabName(int index, const QString &name)
+{
+    const QModelIndex modelIndex = m_model->index(index);
+    if (modelIndex.data().toString() != name)
+        m_model->setData(modelIndex, name);
+}
+
+void TabOverflowPopup::popup(const QPoint &pos, int firstTab, int skippedTab)
+{
+    m_proxy->setRows(firstTab, skippedTab);
+    m_filter->clear();
+    filterChanged(QString());
+
+    const int rows = qMin(m_proxy->rowCount(), MAX_VISIBLE_ROWS);
+    const int rowHeight = rows > 0 ? m_view->sizeHintForRow(0) : 0;
+    m_view->setFixedHeight(rows * rowHeight + 2 * m_view->frameWidth());
+    resize(POPUP_WIDTH, sizeHint().height());
+
+    // Keep the popup on the screen
+    QRect geometry(pos, size());
+    const QRect screen = QApplication::desktop()->availableGeometry(pos);
+    if (geometry.right() > screen.right())
+        geometry.moveRight(screen.right());
+    if (geometry.bottom() > screen.bottom())
+        geometry.moveBottom(screen.bottom());
+    move(geometry.topLeft());
+
+    show();
+    m_filter->setFocus();
+}
+
+bool TabOverflowPopup::eventFilter(QObject *obj, QEvent *event)
+{
+    if (obj == m_filter && event->type() == QEvent::KeyPress) {
+        switch (static_cast<QKeyEvent *>(event)->key()) {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QApplication::sendEvent(m_view, event);
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            activate(m_view->currentIndex());
+            return true;
+        default:
+            break;
+        }
+    }
+    return QFrame::eventFilter(obj, event);
+}
+
+void TabOverflowPopup::filterChanged(const QString &text)
+{
+    m_proxy->setFilterFixedString(text);
+    if (m_proxy->rowCount() > 0)
+        m_view->setCurrentIndex(m_proxy->index(0, 0));
+}
+
+void TabOverflowPopup::activate(const QModelIndex &index)
+{
+    if (!index.isValid())
+        return;
+    const int tab = m_proxy->mapToSource(index).row();
+    hide();
+    emit tabSelected(tab);
+}
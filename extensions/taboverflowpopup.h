@@ -0,0 +1,53 @@
+#ifndef TABOVERFLOWPOPUP_H
+#define TABOVERFLOWPOPUP_H
+
+#include <QFrame>
+
+class QLineEdit;
+class QListView;
+class QModelIndex;
+class QStringListModel;
+
+namespace Manhattan {
+
+class TabOverflowFilter;
+
+// Popup listing the tabs that do not fit into a tab bar. It is created once
+// per tab bar and the list can be narrowed down by typing into its filter.
+// The tab bar keeps the names of all its tabs in sync with the popup, so
+// opening it does not depend on the number of tabs.
+class TabOverflowPopup : public QFrame
+{
+    Q_OBJECT
+public:
+    explicit TabOverflowPopup(QWidget *parent = 0);
+
+    void setTabNames(const QStringList &names);
+    void insertTab(int index, const QString &name);
+    void removeTab(int index);
+    void setTabName(int index, const QString &name);
+
+    // Shows the tabs from firstTab on, except skippedTab, at pos and returns
+    // right away. tabSelected() is emitted when one of them is chosen.
+    void popup(const QPoint &pos, int firstTab, int skippedTab = -1);
+
+signals:
+    void tabSelected(int index);
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event);
+
+private slots:
+    void filterChanged(const QString &text);
+    void activate(const QModelIndex &index);
+
+private:
+    QLineEdit *m_filter;
+    QListView *m_view;
+    QStringListModel *m_model;
+    TabOverflowFilter *m_proxy;
+};
+
+} // namespace Manhattan
+
+#endif // TABOVERFLOWPOPUP_H
@@ -1,14 +1,18 @@
 #include "tabwidget.h"
+#include "pixelratio_p.h"
+#include "tablayout_p.h"
+#include "taboverflowpopup.h"
 #include "../stylehelper.h"
+#include <QAbstractItemModel>
 #include <QRect>
 #include <QPainter>
 #include <QFont>
 #include <QMouseEvent>
-#include <QMenu>
 #include <QToolTip>
 #include <QStyleOption>
 #include <QVBoxLayout>
 #include <QStackedWidget>
+#include <QtAlgorithms>
 #include <QDebug>
 
 using namespace Manhattan;
@@ -31,10 +35,18 @@ static void drawFirstLevelSeparator(QPainter *painter, QPoint top, QPoint bottom
 
 TabWidget::TabWidget(QWidget *parent) :
     QWidget(parent),
+    m_model(0),
     m_currentIndex(-1),
     m_lastVisibleIndex(-1),
     m_stack(0),
-    m_drawFrame(false)
+    m_drawFrame(false),
+    m_layoutDirty(true),
+    m_tabWidthsDirty(true),
+    m_tabsLeft(0),
+    m_visibleCount(0),
+    m_currentPinned(false),
+    m_overflowPopup(0),
+    m_chromeDevicePixelRatio(1)
 {
     QVBoxLayout *layout = new QVBoxLayout;
     layout->setContentsMargins(0, TAB_HEIGHT + CONTENT_HEIGHT_MARGIN + 1, 0, 0);
@@ -60,59 +72,67 @@ void TabWidget::setCurrentIndex(int index)
     if (index == m_currentIndex)
         return;
     m_currentIndex = index;
+    invalidateLayout();
     emit currentIndexChanged(m_currentIndex);
-    update();
 }
 
 void TabWidget::setTitle(const QString &title)
 {
     m_title = title;
-    update();
+    invalidateLayout();
 }
 
 void TabWidget::setFrameVisible(bool visible)
 {
     if (visible != m_drawFrame) {
         m_drawFrame = visible;
-        update();
+        invalidateLayout();
     }
 }
 
-void TabWidget::addTab(const QString &name, QWidget *widget, const QColor &color)
+void TabWidget::insertTabEntry(int index, const QString &name, QWidget *widget, const QColor &color)
 {
-    Q_ASSERT(widget);
     Tab tab;
     tab.name = name;
     tab.color = color;
     tab.widget = widget;
-    m_tabs.append(tab);
+    m_tabs.insert(index, tab);
+    m_nameWidths.insert(index, -1);
+    if (m_overflowPopup)
+        m_overflowPopup->insertTab(index, name);
+}
+
+void TabWidget::addTab(const QString &name, QWidget *widget, const QColor &color)
+{
+    Q_ASSERT(widget);
+    insertTabEntry(m_tabs.size(), name, widget, color);
     m_stack->addWidget(widget);
+    invalidateTabWidths();
     if (m_currentIndex == -1) {
         m_currentIndex = 0;
         emit currentIndexChanged(m_currentIndex);
     }
-    update();
 }
 
 void TabWidget::insertTab(int index, const QString &name, QWidget *widget, const QColor &color)
 {
     Q_ASSERT(widget);
-    Tab tab;
-    tab.name = name;
-    tab.color = color;
-    tab.widget = widget;
-    m_tabs.insert(index, tab);
+    insertTabEntry(index, name, widget, color);
     m_stack->insertWidget(index, widget);
+    invalidateTabWidths();
     if (m_currentIndex >= index) {
         ++m_currentIndex;
         emit currentIndexChanged(m_currentIndex);
     }
-    update();
 }
 
 QWidget* TabWidget::removeTab(int index)
 {
     Tab tab = m_tabs.takeAt(index);
+    m_nameWidths.remove(index);
+    if (m_overflowPopup)
+        m_overflowPopup->removeTab(index);
+    invalidateTabWidths();
     if (index <= m_currentIndex) {
         --m_currentIndex;
         if (m_currentIndex < 0 && m_tabs.size() > 0)
@@ -123,7 +143,6 @@ QWidget* TabWidget::removeTab(int index)
             emit currentIndexChanged(m_currentIndex);
         }
     }
-    update();
     return tab.widget;
 }
 
@@ -137,32 +156,231 @@ QString TabWidget::tabText(int index) const
     return m_tabs.value(index).name;
 }
 
+void TabWidget::setModel(QAbstractItemModel *model)
+{
+    if (model == m_model)
+        return;
+    // Model tabs have no pages, they cannot be mixed with added ones
+    if (m_stack->count() > 0) {
+        qWarning() << "TabWidget: cannot set a model while pages are added";
+        return;
+    }
+    if (m_model)
+        disconnect(m_model, 0, this, 0);
+    m_model = model;
+    if (m_model) {
+        connect(m_model, SIGNAL(rowsInserted(QModelIndex,int,int)),
+                this, SLOT(modelRowsInserted(QModelIndex,int,int)));
+        connect(m_model, SIGNAL(rowsRemoved(QModelIndex,int,int)),
+                this, SLOT(modelRowsRemoved(QModelIndex,int,int)));
+        connect(m_model, SIGNAL(dataChanged(QModelIndex,QModelIndex)),
+                this, SLOT(modelDataChanged(QModelIndex,QModelIndex)));
+        connect(m_model, SIGNAL(rowsMoved(QModelIndex,int,int,QModelIndex,int)),
+                this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(layoutChanged()), this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(modelReset()), this, SLOT(modelReset()));
+        connect(m_model, SIGNAL(destroyed()), this, SLOT(modelDestroyed()));
+    }
+    modelReset();
+}
+
+static QColor tabColor(const QModelIndex &index)
+{
+    const QVariant color = index.data(Qt::ForegroundRole);
+    if (color.canConvert<QBrush>())
+        return color.value<QBrush>().color();
+    if (color.canConvert<QColor>())
+        return color.value<QColor>();
+    return Qt::black;
+}
+
+void TabWidget::insertTabsFromModel(int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        const QModelIndex index = m_model->index(row, 0);
+        insertTabEntry(row, index.data().toString(), 0, tabColor(index));
+    }
+    invalidateTabWidths();
+}
+
+void TabWidget::modelRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+    insertTabsFromModel(first, last);
+    if (m_currentIndex == -1) {
+        m_currentIndex = 0;
+        emit currentIndexChanged(m_currentIndex);
+    } else if (m_currentIndex >= first) {
+        m_currentIndex += last - first + 1;
+        emit currentIndexChanged(m_currentIndex);
+    }
+}
+
+void TabWidget::modelRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if (parent.isValid())
+        return;
+    for (int row = last; row >= first; --row) {
+        m_tabs.removeAt(row);
+        m_nameWidths.remove(row);
+        if (m_overflowPopup)
+            m_overflowPopup->removeTab(row);
+    }
+    invalidateTabWidths();
+    if (first <= m_currentIndex) {
+        if (m_currentIndex > last)
+            m_currentIndex -= last - first + 1;
+        else
+            m_currentIndex = qMax(first - 1, m_tabs.isEmpty() ? -1 : 0);
+        emit currentIndexChanged(m_currentIndex);
+    }
+}
+
+void TabWidget::modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if (topLeft.parent().isValid() || topLeft.column() > 0)
+        return;
+    for (int row = topLeft.row(); row <= bottomRight.row(); ++row) {
+        const QModelIndex index = m_model->index(row, 0);
+        Tab &tab = m_tabs[row];
+        tab.name = index.data().toString();
+        tab.color = tabColor(index);
+        m_nameWidths[row] = -1;
+    }
+    invalidateTabWidths();
+}
+
+void TabWidget::modelReset()
+{
+    const int oldIndex = m_currentIndex;
+    m_tabs.clear();
+    m_nameWidths.clear();
+    if (m_overflowPopup)
+        m_overflowPopup->setTabNames(QStringList());
+    if (m_model && m_model->rowCount() > 0)
+        insertTabsFromModel(0, m_model->rowCount() - 1);
+    else
+        invalidateTabWidths();
+
+    if (m_currentIndex >= m_tabs.size() || (m_currentIndex == -1 && !m_tabs.isEmpty()))
+        m_currentIndex = m_tabs.isEmpty() ? -1 : 0;
+    if (m_currentIndex != oldIndex)
+        emit currentIndexChanged(m_currentIndex);
+}
+
+void TabWidget::modelDestroyed()
+{
+    m_model = 0;
+    modelReset();
+}
+
+void TabWidget::invalidateLayout()
+{
+    m_layoutDirty = true;
+    m_chrome = QPixmap();
+    update();
+}
+
+void TabWidget::invalidateTabWidths()
+{
+    m_tabWidthsDirty = true;
+    invalidateLayout();
+}
+
+/// Decides which tabs are visible. Tabs are shown in order as long as
+/// they fit. If the current tab is not among them, it is pinned after
+/// the last tab that still leaves room for it. The remaining tabs are
+/// reachable through the overflow popup.
+/// Painting and hit testing only read the results of this pass.
+void TabWidget::ensureLayout()
+{
+    if (!m_layoutDirty)
+        return;
+    m_layoutDirty = false;
+
+    const QFontMetrics fm(font());
+    const int tabCount = m_tabs.size();
+
+    if (m_tabWidthsDirty) {
+        m_tabWidthsDirty = false;
+        // m_tabOffsets[i] is where tab i starts, relative to m_tabsLeft,
+        // when all tabs are shown in order
+        Q_ASSERT(m_nameWidths.size() == tabCount);
+        m_tabOffsets.resize(tabCount + 1);
+        m_tabOffsets[0] = 0;
+        for (int i = 0; i < tabCount; ++i) {
+            if (m_nameWidths.at(i) < 0) {
+                m_nameWidths[i] = fm.width(m_tabs.at(i).name);
+                if (m_overflowPopup)
+                    m_overflowPopup->setTabName(i, m_tabs.at(i).name);
+            }
+            m_tabOffsets[i + 1] = m_tabOffsets.at(i) + 2 * MARGIN + m_nameWidths.at(i);
+        }
+    }
+
+    m_tabsLeft = m_title.isEmpty() ? 0 :
+            2 * MARGIN + qMax(fm.width(m_title), MIN_LEFT_MARGIN);
+
+    const int availableWidth = width() - m_tabsLeft;
+    m_currentPinned = false;
+    if (m_tabOffsets.at(tabCount) < availableWidth) {
+        // => everything fits
+        m_visibleCount = tabCount;
+    } else {
+        // => we need the overflow thingy
+        const int overflowLeft = availableWidth - OVERFLOW_DROPDOWN_WIDTH;
+        m_visibleCount = fittingTabs(m_tabOffsets, overflowLeft);
+        if (m_currentIndex >= m_visibleCount) {
+            // make room for the current tab
+            m_currentPinned = true;
+            m_visibleCount = fittingTabs(m_tabOffsets, overflowLeft
+                                         - 2 * MARGIN - m_nameWidths.at(m_currentIndex));
+        }
+    }
+    m_lastVisibleIndex = m_visibleCount - (m_currentPinned ? 0 : 1);
+}
+
+/// Returns the index of the tab shown at slot, where slots are
+/// the visible tabs followed by the entries of the overflow popup
+int TabWidget::tabAtSlot(int slot) const
+{
+    if (!m_currentPinned || slot < m_visibleCount)
+        return slot;
+    if (slot == m_visibleCount)
+        return m_currentIndex;
+    // the pinned current tab is left out of the overflow entries
+    return slot - 1 < m_currentIndex ? slot - 1 : slot;
+}
+
 /// Converts a position to the tab that is undeneath
 /// If HitArea is tab, then the second part of the pair
-/// is the tab number
+/// is the tab slot
 QPair<TabWidget::HitArea, int> TabWidget::convertPosToTab(QPoint pos)
 {
+    ensureLayout();
     if (pos.y() < TAB_HEIGHT) {
         // on the top level part of the bar
-        int eventX = pos.x();
-        QFontMetrics fm(font());
-        int x = m_title.isEmpty() ? 0 :
-                2 * MARGIN + qMax(fm.width(m_title), MIN_LEFT_MARGIN);
+        int eventX = pos.x() - m_tabsLeft;
 
-        if (eventX <= x)
+        if (eventX <= 0)
             return qMakePair(HITNOTHING, -1);
-        int i;
-        for (i = 0; i <= m_lastVisibleIndex; ++i) {
-            int otherX = x + 2 * MARGIN + fm.width(m_tabs.at(
-                    m_currentTabIndices.at(i)).name);
-            if (eventX > x && eventX < otherX) {
-                break;
-            }
+        int x = m_tabOffsets.at(m_visibleCount);
+        if (eventX < x) {
+            // binary search over the tabs shown in order
+            const QVector<int>::const_iterator begin = m_tabOffsets.constBegin();
+            const int slot = qUpperBound(begin, begin + m_visibleCount + 1, eventX) - begin - 1;
+            if (eventX > m_tabOffsets.at(slot))
+                return qMakePair(HITTAB, slot);
+            return qMakePair(HITNOTHING, -1);
+        }
+        if (m_currentPinned) {
+            int otherX = x + 2 * MARGIN + m_nameWidths.at(m_currentIndex);
+            if (eventX > x && eventX < otherX)
+                return qMakePair(HITTAB, m_visibleCount);
             x = otherX;
         }
-        if (i <= m_lastVisibleIndex) {
-            return qMakePair(HITTAB, i);
-        } else if (m_lastVisibleIndex < m_tabs.size() - 1) {
+        if (m_lastVisibleIndex < m_tabs.size() - 1) {
             // handle overflow menu
             if (eventX > x && eventX < x + OVERFLOW_DROPDOWN_WIDTH) {
                 return qMakePair(HITOVERFLOW, -1);
@@ -182,38 +400,70 @@ void TabWidget::mousePressEvent(QMouseEvent *event)
     // should not make any difference
     QPair<HitArea, int> hit = convertPosToTab(event->pos());
     if (hit.first == HITTAB) {
-        if (m_currentIndex != m_currentTabIndices.at(hit.second)) {
-            m_currentIndex = m_currentTabIndices.at(hit.second);
-            update();
+        if (m_currentIndex != tabAtSlot(hit.second)) {
+            m_currentIndex = tabAtSlot(hit.second);
+            invalidateLayout();
             event->accept();
             emit currentIndexChanged(m_currentIndex);
             return;
         }
     } else if (hit.first == HITOVERFLOW) {
-        QMenu overflowMenu;
-        QList<QAction *> actions;
-        for (int i = m_lastVisibleIndex + 1; i < m_tabs.size(); ++i) {
-            actions << overflowMenu.addAction(m_tabs.at(m_currentTabIndices.at(i)).name);
-        }
-        if (QAction *action = overflowMenu.exec(event->globalPos())) { // todo used different position before
-            int index = m_currentTabIndices.at(actions.indexOf(action) + m_lastVisibleIndex + 1);
-            if (m_currentIndex != index) {
-                m_currentIndex = index;
-                update();
-                event->accept();
-                emit currentIndexChanged(m_currentIndex);
-                return;
-            }
+        if (!m_overflowPopup) {
+            m_overflowPopup = new TabOverflowPopup(this);
+            QStringList names;
+            names.reserve(m_tabs.size());
+            foreach (const Tab &tab, m_tabs)
+                names << tab.name;
+            m_overflowPopup->setTabNames(names);
+            connect(m_overflowPopup, SIGNAL(tabSelected(int)), this, SLOT(overflowTabSelected(int)));
         }
+        m_overflowPopup->popup(event->globalPos(), m_visibleCount,
+                               m_currentPinned ? m_currentIndex : -1);
+        event->accept();
+        return;
     }
 
     event->ignore();
 }
 
-void TabWidget::paintEvent(QPaintEvent *event)
+void TabWidget::overflowTabSelected(int index)
 {
-    Q_UNUSED(event)
-    QPainter painter(this);
+    if (index == m_currentIndex || index >= m_tabs.size())
+        return;
+    m_currentIndex = index;
+    invalidateLayout();
+    emit currentIndexChanged(m_currentIndex);
+}
+
+void TabWidget::drawContentBackground(QPainter *painter) const
+{
+    QColor baseColor = palette().window().color();
+    QColor lineColor = baseColor.darker(110).darker();
+
+    // draw content background
+    QRect content(0, TAB_HEIGHT, width(), height() - TAB_HEIGHT);
+    painter->fillRect(content, baseColor);
+
+    // frames
+    painter->setPen(lineColor);
+    if (m_drawFrame)
+        painter->drawRect(content.adjusted(0, 0, -1, -1));
+    else
+        painter->drawLine(content.left(), TAB_HEIGHT, content.right(), TAB_HEIGHT);
+}
+
+void TabWidget::ensureChrome()
+{
+    // The current tab reaches two pixels into the content area
+    const QSize chromeSize(width(), qMin(height(), TAB_HEIGHT + 2));
+    const qreal pixelRatio = chromePixelRatio(this);
+    if (!m_chrome.isNull() && m_chromeSize == chromeSize && m_chromeDevicePixelRatio == pixelRatio)
+        return;
+    m_chromeSize = chromeSize;
+    m_chromeDevicePixelRatio = pixelRatio;
+
+    m_chrome = createChromePixmap(chromeSize, pixelRatio);
+    QPainter painter(&m_chrome);
     QRect r = rect();
 
     QColor baseColor = palette().window().color();
@@ -227,113 +477,25 @@ void TabWidget::paintEvent(QPaintEvent *event)
     if (!m_drawFrame)
         painter.fillRect(r, backgroundColor);
 
-    QFontMetrics fm(font());
-    int baseline = (r.height() + fm.ascent()) / 2 - 1;
-
-    // top level title
-    if (!m_title.isEmpty()) {
-        painter.setPen(Utils::StyleHelper::panelTextColor());
-        painter.drawText(MARGIN, baseline, m_title);
-    }
-    // draw content background
-    QRect content(r);
-    content.setTop(r.height());
-    content.setHeight(height() - r.height());
-    painter.fillRect(content, baseColor);
-
-    // frames
-    if (m_drawFrame) {
-        painter.setPen(lineColor);
-        painter.drawRect(content.adjusted(0, 0, -1, -1));
-    }
-    else {
-        painter.setPen(lineColor);
-        painter.drawLine(r.left(), r.height(), r.right(), r.height());
-    }
+    drawContentBackground(&painter);
 
     // top level tabs
-    int x = m_title.isEmpty() ? 0 :
-            2 * MARGIN + qMax(fm.width(m_title), MIN_LEFT_MARGIN);
-
-    // calculate sizes
-    QList<int> nameWidth;
-    int width = x;
-    int indexSmallerThanOverflow = -1;
-    int indexSmallerThanWidth = -1;
-    for (int i = 0; i < m_tabs.size(); ++i) {
-        const Tab& tab = m_tabs.at(i);
-        int w = fm.width(tab.name);
-        nameWidth << w;
-        width += 2 * MARGIN + w;
-        if (width < r.width())
-            indexSmallerThanWidth = i;
-        if (width < r.width() - OVERFLOW_DROPDOWN_WIDTH)
-            indexSmallerThanOverflow = i;
-    }
-    m_lastVisibleIndex = -1;
-    m_currentTabIndices.resize(m_tabs.size());
-    if (indexSmallerThanWidth == m_tabs.size() - 1) {
-        // => everything fits
-        for (int i = 0; i < m_tabs.size(); ++i)
-            m_currentTabIndices[i] = i;
-        m_lastVisibleIndex = m_tabs.size()-1;
-    } else {
-        // => we need the overflow thingy
-        if (m_currentIndex <= indexSmallerThanOverflow) {
-            // easy going, simply draw everything that fits
-            for (int i = 0; i < m_tabs.size(); ++i)
-                m_currentTabIndices[i] = i;
-            m_lastVisibleIndex = indexSmallerThanOverflow;
-        } else {
-            // now we need to put the current tab into
-            // visible range. for that we need to find the place
-            // to put it, so it fits
-            width = x;
-            int index = 0;
-            bool handledCurrentIndex = false;
-            for (int i = 0; i < m_tabs.size(); ++i) {
-                if (index != m_currentIndex) {
-                    if (!handledCurrentIndex) {
-                        // check if enough room for current tab after this one
-                        if (width + 2 * MARGIN + nameWidth.at(index)
-                                + 2 * MARGIN + nameWidth.at(m_currentIndex)
-                                < r.width() - OVERFLOW_DROPDOWN_WIDTH) {
-                            m_currentTabIndices[i] = index;
-                            ++index;
-                            width += 2 * MARGIN + nameWidth.at(index);
-                        } else {
-                            m_currentTabIndices[i] = m_currentIndex;
-                            handledCurrentIndex = true;
-                            m_lastVisibleIndex = i;
-                        }
-                    } else {
-                        m_currentTabIndices[i] = index;
-                        ++index;
-                    }
-                } else {
-                    ++index;
-                    --i;
-                }
-            }
-        }
-    }
-
-    // actually draw top level tabs
+    int x = m_tabsLeft;
     for (int i = 0; i <= m_lastVisibleIndex; ++i) {
-        int actualIndex = m_currentTabIndices.at(i);
-        const Tab& tab = m_tabs.at(actualIndex);
+        int actualIndex = tabAtSlot(i);
+        const int nameWidth = m_nameWidths.at(actualIndex);
 
         painter.setPen(lineColor);
 
         // top
         if (m_drawFrame) {
-            painter.drawLine(x, 0, x + 2 * MARGIN + fm.width(tab.name), 0);
+            painter.drawLine(x, 0, x + 2 * MARGIN + nameWidth, 0);
         }
 
-        if (actualIndex == m_currentIndex) {            
+        if (actualIndex == m_currentIndex) {
             // tab background
             painter.fillRect(QRect(x, 1,
-                                   2 * MARGIN + fm.width(tab.name),
+                                   2 * MARGIN + nameWidth,
                                    r.height() + 1),
                              baseColor);
 
@@ -348,11 +510,7 @@ void TabWidget::paintEvent(QPaintEvent *event)
                 painter.drawLine(x, 1, x, r.height());
             }
 
-            x += MARGIN;
-            painter.setPen(tab.color);
-            painter.drawText(x, baseline, tab.name);
-            x += nameWidth.at(actualIndex);
-            x += MARGIN;
+            x += 2 * MARGIN + nameWidth;
             painter.setPen(lineColor);
             painter.drawLine(x, 0, x, r.height() - 1);
             painter.setPen(QColor(0, 0, 0, 20));
@@ -362,7 +520,7 @@ void TabWidget::paintEvent(QPaintEvent *event)
         } else {
             // tab background
             painter.fillRect(QRect(x + 1, 1,
-                                   2 * MARGIN + fm.width(tab.name),
+                                   2 * MARGIN + nameWidth,
                                    r.height()-1),
                              backgroundColor);
 
@@ -370,13 +528,7 @@ void TabWidget::paintEvent(QPaintEvent *event)
             if (m_drawFrame && (actualIndex == 0))
                 painter.drawLine(x, 0, x, r.height());
 
-            x += MARGIN;
-            QColor penColor(tab.color);
-            penColor.setAlpha(190);
-            painter.setPen(penColor);
-            painter.drawText(x + 1, baseline, tab.name);
-            x += nameWidth.at(actualIndex);
-            x += MARGIN;
+            x += 2 * MARGIN + nameWidth;
             if (!m_drawFrame || (actualIndex != m_lastVisibleIndex))
                 drawFirstLevelSeparator(&painter, QPoint(x, 1), QPoint(x, r.height()-1));
         }
@@ -399,13 +551,82 @@ void TabWidget::paintEvent(QPaintEvent *event)
     }
 }
 
+void TabWidget::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event)
+    ensureLayout();
+    ensureChrome();
+
+    QPainter painter(this);
+    painter.drawPixmap(0, 0, m_chrome);
+
+    // the rest of the content area is a plain fill
+    if (height() > m_chromeSize.height()) {
+        painter.save();
+        painter.setClipRect(0, m_chromeSize.height(), width(), height() - m_chromeSize.height());
+        drawContentBackground(&painter);
+        painter.restore();
+    }
+
+    QFontMetrics fm(font());
+    int baseline = (TAB_HEIGHT + fm.ascent()) / 2 - 1;
+
+    // top level title
+    if (!m_title.isEmpty()) {
+        painter.setPen(Utils::StyleHelper::panelTextColor());
+        painter.drawText(MARGIN, baseline, m_title);
+    }
+
+    // top level tabs
+    int x = m_tabsLeft;
+    for (int i = 0; i <= m_lastVisibleIndex; ++i) {
+        int actualIndex = tabAtSlot(i);
+        const Tab &tab = m_tabs.at(actualIndex);
+        x += MARGIN;
+        if (actualIndex == m_currentIndex) {
+            painter.setPen(tab.color);
+            painter.drawText(x, baseline, tab.name);
+        } else {
+            QColor penColor(tab.color);
+            penColor.setAlpha(190);
+            painter.setPen(penColor);
+            painter.drawText(x + 1, baseline, tab.name);
+        }
+        x += m_nameWidths.at(actualIndex);
+        x += MARGIN;
+    }
+}
+
+void TabWidget::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    invalidateLayout();
+}
+
+void TabWidget::changeEvent(QEvent *event)
+{
+    QWidget::changeEvent(event);
+    switch (event->type()) {
+    case QEvent::FontChange:
+    case QEvent::StyleChange:
+        m_nameWidths.fill(-1);
+        invalidateTabWidths();
+        break;
+    case QEvent::PaletteChange:
+        invalidateLayout();
+        break;
+    default:
+        break;
+    }
+}
+
 bool TabWidget::event(QEvent *event)
 {
     if (event->type() == QEvent::ToolTip) {
         QHelpEvent *helpevent = static_cast<QHelpEvent*>(event);
         QPair<HitArea, int> hit = convertPosToTab(helpevent->pos());
         if (hit.first == HITTAB)
-            QToolTip::showText(helpevent->globalPos(), m_tabs.at(m_currentTabIndices.at(hit.second)).name, this);
+            QToolTip::showText(helpevent->globalPos(), m_tabs.at(tabAtSlot(hit.second)).name, this);
         else
             QToolTip::showText(helpevent->globalPos(), QString(), this);
     }
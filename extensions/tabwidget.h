@@ -4,11 +4,16 @@
 #include "../qt-manhattan-style_global.hpp"
 #include <QVector>
 #include <QWidget>
+#include <QPixmap>
 
 class QStackedWidget;
+class QAbstractItemModel;
+class QModelIndex;
 
 namespace Manhattan {
 
+class TabOverflowPopup;
+
 class QTMANHATTANSTYLESHARED_EXPORT TabWidget : public QWidget
 {
     Q_OBJECT
@@ -30,12 +35,29 @@ public:
     int currentIndex() const;
     void setCurrentIndex(int index);
 
+    // Binds the tabs to the rows of model, using column 0. Names are taken
+    // from Qt::DisplayRole, colors from Qt::ForegroundRole. Model tabs have
+    // no page widget. Tabs must not be added or removed by hand while a
+    // model is set, and a model cannot be set once pages were added.
+    void setModel(QAbstractItemModel *model);
+    QAbstractItemModel *model() const { return m_model; }
+
 signals:
     void currentIndexChanged(int index);
 
+private slots:
+    void modelRowsInserted(const QModelIndex &parent, int first, int last);
+    void modelRowsRemoved(const QModelIndex &parent, int first, int last);
+    void modelDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+    void modelReset();
+    void modelDestroyed();
+    void overflowTabSelected(int index);
+
 protected:
     void paintEvent(QPaintEvent *event);
     void mousePressEvent(QMouseEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void changeEvent(QEvent *event);
     bool event(QEvent *event);
 
 private:
@@ -46,14 +68,41 @@ private:
     };
     enum HitArea { HITNOTHING, HITOVERFLOW, HITTAB };
     QPair<TabWidget::HitArea, int> convertPosToTab(QPoint pos);
+    void insertTabEntry(int index, const QString &name, QWidget *widget, const QColor &color);
+    void insertTabsFromModel(int first, int last);
+
+    // The layout is computed lazily. Only tabs with an unknown width (-1 in
+    // m_nameWidths) are measured again, other changes only rearrange them.
+    void invalidateLayout();
+    void invalidateTabWidths();
+    void ensureLayout();
+    int tabAtSlot(int slot) const;
+    // Renders the tab bar backgrounds, frames and separators, which only
+    // change with the layout and the palette. Text is drawn over it.
+    void ensureChrome();
+    void drawContentBackground(QPainter *painter) const;
 
     QString m_title;
     QList<Tab> m_tabs;
+    QAbstractItemModel *m_model;
     int m_currentIndex;
-    QVector<int> m_currentTabIndices;
     int m_lastVisibleIndex;
     QStackedWidget *m_stack;
     bool m_drawFrame;
+
+    // Cached layout, see ensureLayout()
+    bool m_layoutDirty;
+    bool m_tabWidthsDirty;
+    int m_tabsLeft;
+    QVector<int> m_nameWidths;
+    QVector<int> m_tabOffsets;
+    int m_visibleCount;
+    bool m_currentPinned;
+    TabOverflowPopup *m_overflowPopup;
+    // m_chrome has m_chromeSize at the widget's device pixel ratio
+    QPixmap m_chrome;
+    QSize m_chromeSize;
+    qreal m_chromeDevicePixelRatio;
 };
 
 } // namespace Manhattan
@@ -30,20 +30,25 @@
 #include "fancymainwindow.h"
 
 #include "qtcassert.h"
+#include "extensions/binarystore.h"
 
 #include <QList>
 #include <QHash>
 
 #include <QAction>
+#include <QChildEvent>
 #include <QContextMenuEvent>
 #include <QMenu>
 #include <QDockWidget>
+#include <QElapsedTimer>
 #include <QSettings>
+#include <QTimer>
 
 static const char lockedKeyC[] = "Locked";
 static const char stateKeyC[] = "State";
 static const int settingsVersion = 2;
 static const char dockWidgetActiveState[] = "DockWidgetActiveState";
+static const int autoSaveDelay = 1000;
 
 namespace Manhattan {
 
@@ -56,9 +61,31 @@ namespace Manhattan {
     in a Window-menu.
 */
 
+// The settings of a layout, parsed once
+struct FancyMainWindowLayout
+{
+    FancyMainWindowLayout() : locked(true) {}
+    explicit FancyMainWindowLayout(const QHash<QString, QVariant> &settings);
+
+    QByteArray state;
+    bool locked;
+    // the active state of the docks, by object name
+    QHash<QString, QVariant> dockStates;
+};
+
+FancyMainWindowLayout::FancyMainWindowLayout(const QHash<QString, QVariant> &settings) :
+    state(settings.value(QLatin1String(stateKeyC), QByteArray()).toByteArray()),
+    locked(settings.value(QLatin1String(lockedKeyC), true).toBool()),
+    dockStates(settings)
+{
+    dockStates.remove(QLatin1String(stateKeyC));
+    dockStates.remove(QLatin1String(lockedKeyC));
+}
+
 struct FancyMainWindowPrivate
 {
     FancyMainWindowPrivate();
+    ~FancyMainWindowPrivate();
 
     bool m_locked;
     bool m_handleDockVisibilityChanges;
@@ -68,6 +95,21 @@ struct FancyMainWindowPrivate
     QAction m_menuSeparator2;
     QAction m_resetLayoutAction;
     QDockWidget *m_toolBarDockWidget;
+
+    BinaryStore *m_autoSaveStore;
+    QString m_autoSaveKey;
+    QTimer m_autoSaveTimer;
+
+    QHash<QString, FancyMainWindowLayout> m_layoutPresets;
+    qint64 m_lastLayoutSwitchTime;
+
+    QList<QDockWidget *> m_dockWidgets;
+    // Children are not fully constructed when they are added, so they
+    // are only checked for being docks in dockWidgets()
+    QList<QObject *> m_newChildren;
+
+    // factories of the docks that were not shown yet
+    QHash<QObject *, DockContentFactory *> m_dockFactories;
 };
 
 FancyMainWindowPrivate::FancyMainWindowPrivate() :
@@ -77,12 +119,21 @@ FancyMainWindowPrivate::FancyMainWindowPrivate() :
     m_toggleLockedAction(FancyMainWindow::tr("Locked"), 0),
     m_menuSeparator2(0),
     m_resetLayoutAction(FancyMainWindow::tr("Reset to Default Layout"), 0),
-    m_toolBarDockWidget(0)
+    m_toolBarDockWidget(0),
+    m_autoSaveStore(0),
+    m_lastLayoutSwitchTime(0)
 {
     m_toggleLockedAction.setCheckable(true);
     m_toggleLockedAction.setChecked(m_locked);
     m_menuSeparator1.setSeparator(true);
     m_menuSeparator2.setSeparator(true);
+    m_autoSaveTimer.setSingleShot(true);
+    m_autoSaveTimer.setInterval(autoSaveDelay);
+}
+
+FancyMainWindowPrivate::~FancyMainWindowPrivate()
+{
+    qDeleteAll(m_dockFactories);
 }
 
 FancyMainWindow::FancyMainWindow(QWidget *parent) :
@@ -92,6 +143,7 @@ FancyMainWindow::FancyMainWindow(QWidget *parent) :
             this, SLOT(setLocked(bool)));
     connect(&d->m_resetLayoutAction, SIGNAL(triggered()),
             this, SIGNAL(resetLayout()));
+    connect(&d->m_autoSaveTimer, SIGNAL(timeout()), this, SLOT(autoSave()));
 }
 
 FancyMainWindow::~FancyMainWindow()
@@ -103,8 +155,24 @@ QDockWidget *FancyMainWindow::addDockForWidget(QWidget *widget)
 {
     QDockWidget *dockWidget = new QDockWidget(widget->windowTitle(), this);
     dockWidget->setWidget(widget);
+    initializeDockWidget(dockWidget, widget->objectName());
+    return dockWidget;
+}
+
+QDockWidget *FancyMainWindow::addDockForFactory(const QString &objectName, const QString &title,
+                                                DockContentFactory *factory)
+{
+    QTC_ASSERT(factory, return 0);
+    QDockWidget *dockWidget = new QDockWidget(title, this);
+    dockWidget->setWidget(new QWidget);
+    d->m_dockFactories.insert(dockWidget, factory);
+    initializeDockWidget(dockWidget, objectName);
+    return dockWidget;
+}
+
+void FancyMainWindow::initializeDockWidget(QDockWidget *dockWidget, const QString &objectName)
+{
     // Set an object name to be used in settings, derive from widget name
-    const QString objectName = widget->objectName();
     if (objectName.isEmpty()) {
         dockWidget->setObjectName(QLatin1String("dockWidget") + QString::number(dockWidgets().size() + 1));
     } else {
@@ -116,9 +184,21 @@ QDockWidget *FancyMainWindow::addDockForWidget(QWidget *widget)
             this, SLOT(onDockVisibilityChange(bool)));
     connect(dockWidget, SIGNAL(topLevelChanged(bool)),
             this, SLOT(onTopLevelChanged()));
+    // moves of the dock area separators only show up as resizes
+    dockWidget->installEventFilter(this);
     dockWidget->setProperty(dockWidgetActiveState, true);
     updateDockWidget(dockWidget);
-    return dockWidget;
+}
+
+void FancyMainWindow::createDockContent(QDockWidget *dockWidget)
+{
+    DockContentFactory *factory = d->m_dockFactories.take(dockWidget);
+    if (!factory)
+        return;
+    QWidget *placeholder = dockWidget->widget();
+    dockWidget->setWidget(factory->createWidget());
+    delete placeholder;
+    delete factory;
 }
 
 void FancyMainWindow::updateDockWidget(QDockWidget *dockWidget)
@@ -152,11 +232,42 @@ void FancyMainWindow::onDockVisibilityChange(bool visible)
 {
     if (d->m_handleDockVisibilityChanges)
         sender()->setProperty(dockWidgetActiveState, visible);
+    if (visible)
+        createDockContent(static_cast<QDockWidget *>(sender()));
+    scheduleAutoSave();
 }
 
 void FancyMainWindow::onTopLevelChanged()
 {
     updateDockWidget(qobject_cast<QDockWidget*>(sender()));
+    scheduleAutoSave();
+}
+
+bool FancyMainWindow::eventFilter(QObject *object, QEvent *event)
+{
+    if (event->type() == QEvent::Resize || event->type() == QEvent::Move)
+        scheduleAutoSave();
+    return QMainWindow::eventFilter(object, event);
+}
+
+void FancyMainWindow::setAutoSave(BinaryStore *store, const QString &key)
+{
+    d->m_autoSaveTimer.stop();
+    d->m_autoSaveStore = store;
+    d->m_autoSaveKey = key;
+}
+
+void FancyMainWindow::scheduleAutoSave()
+{
+    if (d->m_autoSaveStore)
+        d->m_autoSaveTimer.start();
+}
+
+void FancyMainWindow::autoSave()
+{
+    d->m_autoSaveTimer.stop();
+    if (d->m_autoSaveStore)
+        saveSettings(d->m_autoSaveStore, d->m_autoSaveKey);
 }
 
 void FancyMainWindow::setTrackingEnabled(bool enabled)
@@ -176,12 +287,16 @@ void FancyMainWindow::setLocked(bool locked)
     foreach (QDockWidget *dockWidget, dockWidgets()) {
         updateDockWidget(dockWidget);
     }
+    scheduleAutoSave();
 }
 
 void FancyMainWindow::hideEvent(QHideEvent *event)
 {
     Q_UNUSED(event)
     handleVisibilityChanged(false);
+    // do not wait for the timer, the application may be quitting
+    if (d->m_autoSaveTimer.isActive())
+        autoSave();
 }
 
 void FancyMainWindow::showEvent(QShowEvent *event)
@@ -229,6 +344,32 @@ void FancyMainWindow::restoreSettings(const QSettings *settings)
     restoreSettings(hash);
 }
 
+void FancyMainWindow::saveSettings(BinaryStore *store, const QString &key) const
+{
+    const QString prefix = key + QLatin1Char('/');
+    QHash<QString, QVariant> changed;
+    QHashIterator<QString, QVariant> it(saveSettings());
+    while (it.hasNext()) {
+        it.next();
+        const QString storeKey = prefix + it.key();
+        if (store->value(storeKey) != it.value())
+            changed.insert(storeKey, it.value());
+    }
+    if (!changed.isEmpty())
+        store->setValues(changed);
+}
+
+void FancyMainWindow::restoreSettings(const BinaryStore *store, const QString &key)
+{
+    const QString prefix = key + QLatin1Char('/');
+    QHash<QString, QVariant> hash;
+    foreach (const QString &storeKey, store->keys()) {
+        if (storeKey.startsWith(prefix) && storeKey.indexOf(QLatin1Char('/'), prefix.size()) == -1)
+            hash.insert(storeKey.mid(prefix.size()), store->value(storeKey));
+    }
+    restoreSettings(hash);
+}
+
 QHash<QString, QVariant> FancyMainWindow::saveSettings() const
 {
     QHash<QString, QVariant> settings;
@@ -243,20 +384,89 @@ QHash<QString, QVariant> FancyMainWindow::saveSettings() const
 
 void FancyMainWindow::restoreSettings(const QHash<QString, QVariant> &settings)
 {
-    QByteArray ba = settings.value(QLatin1String(stateKeyC), QByteArray()).toByteArray();
-    if (!ba.isEmpty())
-        restoreState(ba, settingsVersion);
-    d->m_locked = settings.value(QLatin1String("Locked"), true).toBool();
+    applyLayout(FancyMainWindowLayout(settings));
+}
+
+void FancyMainWindow::applyLayout(const FancyMainWindowLayout &layout)
+{
+    if (!layout.state.isEmpty())
+        restoreState(layout.state, settingsVersion);
+    d->m_locked = layout.locked;
     d->m_toggleLockedAction.setChecked(d->m_locked);
     foreach (QDockWidget *widget, dockWidgets()) {
         widget->setProperty(dockWidgetActiveState,
-            settings.value(widget->objectName(), false));
+            layout.dockStates.value(widget->objectName(), false));
     }
 }
 
+void FancyMainWindow::saveLayoutPreset(const QString &name)
+{
+    d->m_layoutPresets.insert(name, FancyMainWindowLayout(saveSettings()));
+}
+
+void FancyMainWindow::setLayoutPreset(const QString &name, const QHash<QString, QVariant> &settings)
+{
+    d->m_layoutPresets.insert(name, FancyMainWindowLayout(settings));
+}
+
+bool FancyMainWindow::restoreLayoutPreset(const QString &name)
+{
+    QHash<QString, FancyMainWindowLayout>::const_iterator it = d->m_layoutPresets.constFind(name);
+    if (it == d->m_layoutPresets.constEnd())
+        return false;
+    QElapsedTimer timer;
+    timer.start();
+    // Docks would otherwise be repainted one by one as they move
+    const bool updates = updatesEnabled();
+    setUpdatesEnabled(false);
+    applyLayout(it.value());
+    setUpdatesEnabled(updates);
+    d->m_lastLayoutSwitchTime = timer.nsecsElapsed();
+    return true;
+}
+
+void FancyMainWindow::removeLayoutPreset(const QString &name)
+{
+    d->m_layoutPresets.remove(name);
+}
+
+QStringList FancyMainWindow::layoutPresets() const
+{
+    return d->m_layoutPresets.keys();
+}
+
+qint64 FancyMainWindow::lastLayoutSwitchTime() const
+{
+    return d->m_lastLayoutSwitchTime;
+}
+
+void FancyMainWindow::childEvent(QChildEvent *event)
+{
+    QObject *child = event->child();
+    if (event->added()) {
+        if (child->isWidgetType())
+            d->m_newChildren.append(child);
+    } else if (event->removed()) {
+        d->m_newChildren.removeOne(child);
+        delete d->m_dockFactories.take(child);
+        for (int i = 0; i < d->m_dockWidgets.size(); ++i) {
+            if (d->m_dockWidgets.at(i) == child) {
+                d->m_dockWidgets.removeAt(i);
+                break;
+            }
+        }
+    }
+    QMainWindow::childEvent(event);
+}
+
 QList<QDockWidget *> FancyMainWindow::dockWidgets() const
 {
-    return qFindChildren<QDockWidget *>(this);
+    foreach (QObject *child, d->m_newChildren) {
+        if (QDockWidget *dockWidget = qobject_cast<QDockWidget *>(child))
+            d->m_dockWidgets.append(dockWidget);
+    }
+    d->m_newChildren.clear();
+    return d->m_dockWidgets;
 }
 
 bool FancyMainWindow::isLocked() const
@@ -274,7 +484,7 @@ static bool actionLessThan(const QAction *action1, const QAction *action2)
 QMenu *FancyMainWindow::createPopupMenu()
 {
     QList<QAction *> actions;
-    QList<QDockWidget *> dockwidgets = qFindChildren<QDockWidget *>(this);
+    QList<QDockWidget *> dockwidgets = dockWidgets();
     for (int i = 0; i < dockwidgets.size(); ++i) {
         QDockWidget *dockWidget = dockwidgets.at(i);
         if (dockWidget->property("managed_dockwidget").isNull()
@@ -40,6 +40,17 @@ QT_END_NAMESPACE
 
 namespace Manhattan {
 
+class BinaryStore;
+struct FancyMainWindowLayout;
+
+// Creates the content of a dock added with FancyMainWindow::addDockForFactory()
+class QTMANHATTANSTYLESHARED_EXPORT DockContentFactory
+{
+public:
+    virtual ~DockContentFactory() {}
+    virtual QWidget *createWidget() = 0;
+};
+
 struct FancyMainWindowPrivate;
 
 class QTMANHATTANSTYLESHARED_EXPORT FancyMainWindow : public QMainWindow
@@ -53,6 +64,14 @@ public:
     /* The widget passed in should have an objectname set
      * which will then be used as key for QSettings. */
     QDockWidget *addDockForWidget(QWidget *widget);
+    /* Adds a dock showing a placeholder, the content is only created by
+     * factory when the dock is first shown. The object name is used like
+     * the one of the widget in addDockForWidget(). Takes ownership of
+     * factory. */
+    QDockWidget *addDockForFactory(const QString &objectName, const QString &title,
+                                   DockContentFactory *factory);
+    // The dock widgets among the children of the window, kept up to date
+    // from child events instead of searching the object tree
     QList<QDockWidget *> dockWidgets() const;
 
     void setTrackingEnabled(bool enabled);
@@ -62,6 +81,24 @@ public:
     void restoreSettings(const QSettings *settings);
     QHash<QString, QVariant> saveSettings() const;
     void restoreSettings(const QHash<QString, QVariant> &settings);
+    // Keeps the state in store as one record per value below key,
+    // only changed values are written
+    void saveSettings(BinaryStore *store, const QString &key) const;
+    void restoreSettings(const BinaryStore *store, const QString &key);
+
+    // Saves the state to store shortly after docks were shown, hidden,
+    // moved or resized. Pass 0 to turn it off.
+    void setAutoSave(BinaryStore *store, const QString &key);
+
+    // Named layouts kept in memory in parsed form. Restoring one suppresses
+    // updates, so a switch costs a single relayout and repaint.
+    void saveLayoutPreset(const QString &name);
+    void setLayoutPreset(const QString &name, const QHash<QString, QVariant> &settings);
+    bool restoreLayoutPreset(const QString &name);
+    void removeLayoutPreset(const QString &name);
+    QStringList layoutPresets() const;
+    // How long the last restoreLayoutPreset() took, in nanoseconds
+    qint64 lastLayoutSwitchTime() const;
 
     // Additional context menu actions
     QAction *menuSeparator1() const;
@@ -89,12 +126,19 @@ protected:
     void hideEvent(QHideEvent *event);
     void showEvent(QShowEvent *event);
     void contextMenuEvent(QContextMenuEvent *event);
+    bool eventFilter(QObject *object, QEvent *event);
+    void childEvent(QChildEvent *event);
 private slots:
     void onDockActionTriggered();
     void onDockVisibilityChange(bool);
     void onTopLevelChanged();
+    void autoSave();
 
 private:
+    void initializeDockWidget(QDockWidget *dockWidget, const QString &objectName);
+    void createDockContent(QDockWidget *dockWidget);
+    void scheduleAutoSave();
+    void applyLayout(const FancyMainWindowLayout &layout);
     void updateDockWidget(QDockWidget *dockWidget);
     void handleVisibilityChanged(bool visible);
 
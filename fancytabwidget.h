@@ -73,7 +73,7 @@ private:
     float m_fader;
 };
 
-class FancyTabBar : public QWidget
+class QTMANHATTANSTYLESHARED_EXPORT FancyTabBar : public QWidget
 {
     Q_OBJECT
 
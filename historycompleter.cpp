@@ -30,9 +30,21 @@
 #include "historycompleter.h"
 
 #include "qtcassert.h"
+#include "extensions/binarystore.h"
 
 #include <QAbstractListModel>
+#include <QBasicTimer>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDateTime>
+#include <QHash>
+#include <QRunnable>
 #include <QSettings>
+#include <QThreadPool>
+#include <QTimerEvent>
+#include <QVector>
+#include <QtAlgorithms>
+#include <qmath.h>
 
 #include <QItemDelegate>
 #include <QKeyEvent>
@@ -43,12 +55,202 @@
 
 namespace Manhattan {
 
+class HistoryStore;
+
 static QSettings *theSettings = 0;
+static BinaryStore *theBinaryStore = 0;
+static QHash<QString, HistoryStore *> theStores;
+
+// Time to wait for further changes before histories are written
+static const int HISTORY_WRITE_DELAY = 1000;
+
+class HistoryWriteTask : public QRunnable
+{
+public:
+    HistoryWriteTask(BinaryStore *binaryStore, const QString &fileName, QSettings::Format format,
+                     const QHash<QString, QVariant> &values)
+        : m_binaryStore(binaryStore), m_fileName(fileName), m_format(format), m_values(values)
+    {}
+
+    // QSettings objects must not be shared between threads, but separate
+    // objects on the same file are kept consistent by QSettings itself
+    void run()
+    {
+        if (m_binaryStore) {
+            m_binaryStore->setValues(m_values);
+            return;
+        }
+        QSettings settings(m_fileName, m_format);
+        QHash<QString, QVariant>::const_iterator it = m_values.constBegin();
+        for ( ; it != m_values.constEnd(); ++it)
+            settings.setValue(it.key(), it.value());
+        settings.sync();
+    }
+
+private:
+    BinaryStore *m_binaryStore;
+    QString m_fileName;
+    QSettings::Format m_format;
+    QHash<QString, QVariant> m_values;
+};
 
-class HistoryCompleterPrivate : public QAbstractListModel
+// Collects the changed histories per key and writes them on a worker
+// thread once no further change came in for HISTORY_WRITE_DELAY.
+class HistoryWriter : public QObject
 {
 public:
-    HistoryCompleterPrivate() : maxLines(30), lineEdit(0) {}
+    static HistoryWriter *instance();
+
+    void schedule(const QString &key, const QVariant &value);
+    QVariant value(const QString &key) const;
+    void flush();
+
+protected:
+    void timerEvent(QTimerEvent *event);
+
+private:
+    HistoryWriter();
+    QString absoluteKey(const QString &key) const;
+    void submit();
+
+    // The settings are only touched when scheduling, they may be gone
+    // by the time the post routine flushes
+    BinaryStore *m_binaryStore;
+    QString m_fileName;
+    QSettings::Format m_format;
+    QHash<QString, QVariant> m_pending;
+    QBasicTimer m_timer;
+    QThreadPool m_pool;
+};
+
+static void flushHistoryWriter()
+{
+    HistoryWriter::instance()->flush();
+}
+
+HistoryWriter::HistoryWriter()
+    : m_binaryStore(0), m_format(QSettings::NativeFormat)
+{
+    // a single thread keeps the batches in order
+    m_pool.setMaxThreadCount(1);
+    qAddPostRoutine(flushHistoryWriter);
+}
+
+HistoryWriter *HistoryWriter::instance()
+{
+    static HistoryWriter *writer = 0;
+    if (!writer)
+        writer = new HistoryWriter;
+    return writer;
+}
+
+QString HistoryWriter::absoluteKey(const QString &key) const
+{
+    if (theBinaryStore)
+        return key;
+    const QString group = theSettings->group();
+    return group.isEmpty() ? key : group + QLatin1Char('/') + key;
+}
+
+void HistoryWriter::schedule(const QString &key, const QVariant &value)
+{
+    QTC_ASSERT(theSettings || theBinaryStore, return);
+    m_binaryStore = theBinaryStore;
+    if (!m_binaryStore) {
+        m_fileName = theSettings->fileName();
+        m_format = theSettings->format();
+    }
+    m_pending.insert(absoluteKey(key), value);
+    m_timer.start(HISTORY_WRITE_DELAY, this);
+}
+
+/// Returns the value of key, including changes that are not written yet
+QVariant HistoryWriter::value(const QString &key) const
+{
+    QHash<QString, QVariant>::const_iterator it = m_pending.constFind(absoluteKey(key));
+    if (it != m_pending.constEnd())
+        return it.value();
+    if (theBinaryStore)
+        return theBinaryStore->value(key);
+    return theSettings->value(key);
+}
+
+void HistoryWriter::submit()
+{
+    m_timer.stop();
+    if (m_pending.isEmpty())
+        return;
+    m_pool.start(new HistoryWriteTask(m_binaryStore, m_fileName, m_format, m_pending));
+    m_pending.clear();
+}
+
+void HistoryWriter::flush()
+{
+    submit();
+    m_pool.waitForDone();
+}
+
+void HistoryWriter::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_timer.timerId())
+        submit();
+    else
+        QObject::timerEvent(event);
+}
+
+// Orders the entries of a history, best first. Scores are only used when
+// ranking by use; otherwise newer entries, with larger serials, come first.
+struct HistoryRank
+{
+    double score;
+    int serial;
+};
+
+static inline bool operator>(const HistoryRank &a, const HistoryRank &b)
+{
+    return a.score > b.score || (a.score == b.score && a.serial > b.serial);
+}
+
+struct HistoryIndexEntry
+{
+    QString folded;
+    HistoryRank rank;
+};
+
+static inline bool operator<(const HistoryIndexEntry &a, const HistoryIndexEntry &b)
+{
+    const int cmp = a.folded.compare(b.folded);
+    return cmp < 0 || (cmp == 0 && a.rank.serial < b.rank.serial);
+}
+
+static const double HISTORY_HALF_LIFE_DAYS = 7;
+
+static double currentUseTime()
+{
+    return QDateTime::currentMSecsSinceEpoch() / (HISTORY_HALF_LIFE_DAYS * 24 * 3600 * 1000);
+}
+
+// A score is log2 of the sum of 2^t over the times t of all uses, with t
+// counted in half lives. Scaled by 2^-now this is a use count that halves
+// every half life, but the stored scores never need to be decayed and
+// their order does not change over time.
+static double addUse(double score, double now)
+{
+    const double high = qMax(score, now);
+    const double low = qMin(score, now);
+    return high + qLn(1 + qPow(2, low - high)) / M_LN2;
+}
+
+class HistoryFilterModel;
+
+// The history of one key, shared by all completers for that key. The
+// entries are only read once they are needed, the lookups only once the
+// history is searched or changed.
+class HistoryStore : public QAbstractListModel
+{
+public:
+    static HistoryStore *acquire(const QString &key);
+    void release();
 
     int rowCount(const QModelIndex &parent = QModelIndex()) const;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
@@ -57,10 +259,93 @@ public:
     void clearHistory();
     void saveEntry(const QString &str);
 
-    QStringList list;
+    bool isRanked() const { return ranked; }
+    void setRanked(bool ranked);
+
+    void addFilter(HistoryFilterModel *filter) { filters.append(filter); }
+    void removeFilter(HistoryFilterModel *filter) { filters.removeOne(filter); }
+
+    int rowOfRank(const HistoryRank &rank) const;
+    QVector<int> prefixMatches(const QString &prefix, Qt::CaseSensitivity cs);
+
+    const QStringList &entries() const { ensureLoaded(); return list; }
+
+    // the key in theStores
+    QString storeKey;
     QString historyKey;
+    QString scoresKey;
     int maxLines;
+
+private:
+    HistoryStore(const QString &key);
+    void ensureLoaded() const;
+    void ensureIndexed();
+    void resetIndex();
+    void useEntry(const QString &entry, int serial);
+    void takeRow(int row);
+    void insertIndex(const QString &entry, const HistoryRank &rank);
+    QVector<HistoryIndexEntry>::iterator findIndex(const QString &entry, int serial);
+    void historyChanged();
+    QByteArray packedScores() const;
+
+    mutable QStringList list;
+    mutable bool loaded;
+    // ranks[i] orders list[i], the list is sorted by it
+    QVector<HistoryRank> ranks;
+    QHash<QString, int> serialOf;
+    // the case folded entries, sorted for prefix lookups
+    QVector<HistoryIndexEntry> index;
+    int nextSerial;
+    bool indexed;
+    bool ranked;
+
+    QList<HistoryFilterModel *> filters;
+    int refCount;
+};
+
+class HistoryCompleterPrivate
+{
+public:
+    HistoryCompleterPrivate() : store(0), filter(0), lineEdit(0), textPending(true) {}
+    ~HistoryCompleterPrivate();
+
+    HistoryStore *store;
+    HistoryFilterModel *filter;
     QLineEdit *lineEdit;
+    // the line edit is filled in when it is first shown
+    bool textPending;
+};
+
+// The rows of the history that match the completion prefix. Prefixes are
+// looked up in the index of the history. Fuzzy patterns are matched as
+// subsequences, and a longer pattern only searches the previous result.
+class HistoryFilterModel : public QAbstractListModel
+{
+public:
+    HistoryFilterModel(HistoryStore *history)
+        : m_history(history), m_caseSensitivity(Qt::CaseSensitive),
+          m_fuzzy(false), m_unfiltered(true)
+    {}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
+
+    void setPattern(const QString &pattern, Qt::CaseSensitivity cs);
+    void setFuzzy(bool fuzzy);
+    bool isFuzzy() const { return m_fuzzy; }
+    void refresh() { filter(false); }
+
+private:
+    int sourceRow(int row) const { return m_unfiltered ? row : m_rows.at(row); }
+    void filter(bool narrow);
+
+    HistoryStore *m_history;
+    QString m_pattern;
+    Qt::CaseSensitivity m_caseSensitivity;
+    bool m_fuzzy;
+    bool m_unfiltered;
+    QVector<int> m_rows;
 };
 
 class HistoryLineDelegate : public QItemDelegate
@@ -83,7 +368,7 @@ public:
 class HistoryLineView : public QListView
 {
 public:
-    HistoryLineView(HistoryCompleterPrivate *model_)
+    HistoryLineView(QAbstractItemModel *model_)
         : model(model_)
     {
         HistoryLineDelegate *delegate = new HistoryLineDelegate;
@@ -104,17 +389,52 @@ private:
         QListView::mousePressEvent(event);
     }
 
-    HistoryCompleterPrivate *model;
+    QAbstractItemModel *model;
     int pixmapWidth;
 };
 
-int HistoryCompleterPrivate::rowCount(const QModelIndex &parent) const
+HistoryStore::HistoryStore(const QString &key)
+    : storeKey(key),
+      historyKey(QLatin1String("CompleterHistory/") + key),
+      scoresKey(QLatin1String("CompleterHistoryScores/") + key),
+      maxLines(30), loaded(false), nextSerial(1), indexed(false), ranked(false), refCount(0)
 {
-    return parent.isValid() ? 0 : list.count();
 }
 
-QVariant HistoryCompleterPrivate::data(const QModelIndex &index, int role) const
+void HistoryStore::ensureLoaded() const
 {
+    if (loaded)
+        return;
+    loaded = true;
+    QTC_ASSERT(theSettings || theBinaryStore, return);
+    list = HistoryWriter::instance()->value(historyKey).toStringList();
+}
+
+HistoryStore *HistoryStore::acquire(const QString &key)
+{
+    HistoryStore *&store = theStores[key];
+    if (!store)
+        store = new HistoryStore(key);
+    ++store->refCount;
+    return store;
+}
+
+void HistoryStore::release()
+{
+    if (--refCount > 0)
+        return;
+    theStores.remove(storeKey);
+    delete this;
+}
+
+int HistoryStore::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : entries().count();
+}
+
+QVariant HistoryStore::data(const QModelIndex &index, int role) const
+{
+    ensureLoaded();
     if (index.row() >= list.count() || index.column() != 0)
         return QVariant();
     if (role == Qt::DisplayRole || role == Qt::EditRole)
@@ -122,33 +442,339 @@ QVariant HistoryCompleterPrivate::data(const QModelIndex &index, int role) const
     return QVariant();
 }
 
-bool HistoryCompleterPrivate::removeRows(int row, int count, const QModelIndex &parent)
+bool HistoryStore::removeRows(int row, int count, const QModelIndex &parent)
 {
-    beginRemoveRows (parent, row, row + count);
-    list.removeAt(row);
-    theSettings->setValue(historyKey, list);
+    ensureLoaded();
+    if (row < 0 || count < 1 || row + count > list.count())
+        return false;
+    ensureIndexed();
+    beginRemoveRows(parent, row, row + count - 1);
+    for (int i = 0; i < count; ++i)
+        takeRow(row);
     endRemoveRows();
+    historyChanged();
     return true;
 }
 
-void HistoryCompleterPrivate::clearHistory()
+void HistoryStore::clearHistory()
 {
+    beginResetModel();
     list.clear();
-    reset();
+    loaded = true;
+    resetIndex();
+    indexed = true;
+    endResetModel();
+    foreach (HistoryFilterModel *filter, filters)
+        filter->refresh();
 }
 
-void HistoryCompleterPrivate::saveEntry(const QString &str)
+void HistoryStore::saveEntry(const QString &str)
 {
-    QTC_ASSERT(theSettings, return);
+    QTC_ASSERT(theSettings || theBinaryStore, return);
     if (str.isEmpty())
         return;
-    if (list.contains(str))
+    ensureIndexed();
+    QHash<QString, int>::const_iterator it = serialOf.constFind(str);
+    if (it != serialOf.constEnd()) {
+        if (ranked)
+            useEntry(str, it.value());
         return;
-    beginInsertRows (QModelIndex(), list.count(), list.count());
-    list.prepend(str);
-    list = list.mid(0, maxLines);
+    }
+
+    const HistoryRank rank = { ranked ? currentUseTime() : 0, nextSerial++ };
+    const int row = rowOfRank(rank);
+    beginInsertRows(QModelIndex(), row, row);
+    list.insert(row, str);
+    ranks.insert(row, rank);
+    serialOf.insert(str, rank.serial);
+    insertIndex(str, rank);
     endInsertRows();
-    theSettings->setValue(historyKey, list);
+    if (list.count() > maxLines) {
+        beginRemoveRows(QModelIndex(), maxLines, list.count() - 1);
+        while (list.count() > maxLines)
+            takeRow(list.count() - 1);
+        endRemoveRows();
+    }
+    historyChanged();
+}
+
+/// Raises the score of an entry that is used again. Only that entry
+/// moves, its new row is found with a binary search.
+void HistoryStore::useEntry(const QString &entry, int serial)
+{
+    QVector<HistoryIndexEntry>::iterator it = findIndex(entry, serial);
+    QTC_ASSERT(it != index.end(), return);
+    const int row = rowOfRank(it->rank);
+    it->rank.score = addUse(it->rank.score, currentUseTime());
+
+    // Finding the rows is O(log n), moving the entry shifts the ones in
+    // between and is O(n). That is a memmove of at most maxLines pointers,
+    // while the model and the completer need the rows as plain indexes,
+    // which an ordered tree would only give in O(n) again.
+    ranks.remove(row);
+    const int newRow = rowOfRank(it->rank);
+    ranks.insert(newRow, it->rank);
+    if (newRow != row) {
+        beginMoveRows(QModelIndex(), row, row, QModelIndex(), newRow);
+        list.move(row, newRow);
+        endMoveRows();
+    }
+    historyChanged();
+}
+
+static QVector<double> unpackScores(const QByteArray &data, int count)
+{
+    QVector<double> scores;
+    QDataStream stream(data);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    while (!stream.atEnd() && scores.count() < count) {
+        float score;
+        stream >> score;
+        // scores of another version of the list
+        if (!scores.isEmpty() && score > scores.last())
+            return QVector<double>();
+        scores.append(score);
+    }
+    if (scores.count() != count || !stream.atEnd())
+        return QVector<double>();
+    return scores;
+}
+
+QByteArray HistoryStore::packedScores() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+    foreach (const HistoryRank &rank, ranks)
+        stream << float(rank.score);
+    return data;
+}
+
+void HistoryStore::setRanked(bool on)
+{
+    if (on == ranked)
+        return;
+    ranked = on;
+    // Entries are renumbered in their current order, with the stored
+    // scores or without scores, see ensureIndexed()
+    resetIndex();
+    foreach (HistoryFilterModel *filter, filters)
+        filter->refresh();
+}
+
+void HistoryStore::resetIndex()
+{
+    ranks.clear();
+    serialOf.clear();
+    index.clear();
+    indexed = false;
+}
+
+void HistoryStore::ensureIndexed()
+{
+    if (indexed)
+        return;
+    indexed = true;
+    ensureLoaded();
+    const int count = list.count();
+    QVector<double> storedScores;
+    if (ranked)
+        storedScores = unpackScores(HistoryWriter::instance()->value(scoresKey).toByteArray(), count);
+    ranks.reserve(count);
+    index.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const QString &entry = list.at(i);
+        const HistoryRank rank = { storedScores.value(i, 0), count - i };
+        ranks.append(rank);
+        // the best one wins if the stored list has duplicates
+        if (!serialOf.contains(entry))
+            serialOf.insert(entry, rank.serial);
+        const HistoryIndexEntry indexEntry = { entry.toCaseFolded(), rank };
+        index.append(indexEntry);
+    }
+    qSort(index);
+    nextSerial = count + 1;
+}
+
+void HistoryStore::takeRow(int row)
+{
+    const QString entry = list.takeAt(row);
+    const int serial = ranks.at(row).serial;
+    ranks.remove(row);
+    if (serialOf.value(entry) == serial)
+        serialOf.remove(entry);
+    QVector<HistoryIndexEntry>::iterator it = findIndex(entry, serial);
+    QTC_ASSERT(it != index.end(), return);
+    index.erase(it);
+}
+
+void HistoryStore::insertIndex(const QString &entry, const HistoryRank &rank)
+{
+    const HistoryIndexEntry indexEntry = { entry.toCaseFolded(), rank };
+    index.insert(qLowerBound(index.begin(), index.end(), indexEntry), indexEntry);
+}
+
+QVector<HistoryIndexEntry>::iterator HistoryStore::findIndex(const QString &entry, int serial)
+{
+    const HistoryIndexEntry key = { entry.toCaseFolded(), { 0, serial } };
+    QVector<HistoryIndexEntry>::iterator it = qLowerBound(index.begin(), index.end(), key);
+    if (it != index.end() && it->rank.serial == serial)
+        return it;
+    return index.end();
+}
+
+void HistoryStore::historyChanged()
+{
+    HistoryWriter::instance()->schedule(historyKey, list);
+    if (ranked)
+        HistoryWriter::instance()->schedule(scoresKey, packedScores());
+    foreach (HistoryFilterModel *filter, filters)
+        filter->refresh();
+}
+
+int HistoryStore::rowOfRank(const HistoryRank &rank) const
+{
+    return qLowerBound(ranks.constBegin(), ranks.constEnd(), rank, qGreater<HistoryRank>())
+            - ranks.constBegin();
+}
+
+/// Returns the rows of the entries starting with prefix, in list order
+QVector<int> HistoryStore::prefixMatches(const QString &prefix, Qt::CaseSensitivity cs)
+{
+    ensureIndexed();
+    const HistoryIndexEntry key = { prefix.toCaseFolded(), { 0, 0 } };
+    QVector<HistoryRank> matches;
+    QVector<HistoryIndexEntry>::const_iterator it = qLowerBound(index.constBegin(), index.constEnd(), key);
+    for ( ; it != index.constEnd() && it->folded.startsWith(key.folded); ++it)
+        matches.append(it->rank);
+    qSort(matches.begin(), matches.end(), qGreater<HistoryRank>());
+
+    QVector<int> rows;
+    rows.reserve(matches.count());
+    foreach (const HistoryRank &rank, matches) {
+        const int row = rowOfRank(rank);
+        // the index is case insensitive
+        if (cs == Qt::CaseInsensitive || list.at(row).startsWith(prefix))
+            rows.append(row);
+    }
+    return rows;
+}
+
+// Scores text as a match of pattern, which is folded already for case
+// insensitive matching. Returns -1 unless pattern is a subsequence of
+// text. Matches at word starts and runs of matching characters count
+// more, skipped characters count against the match.
+static int fuzzyScore(const QString &text, const QString &pattern, Qt::CaseSensitivity cs)
+{
+    const int patternSize = pattern.size();
+    int matched = 0;
+    int run = 0;
+    int score = 0;
+    for (int i = 0; i < text.size() && matched < patternSize; ++i) {
+        QChar c = text.at(i);
+        if (cs == Qt::CaseInsensitive)
+            c = c.toCaseFolded();
+        if (c != pattern.at(matched)) {
+            run = 0;
+            if (matched > 0)
+                --score;
+            continue;
+        }
+        ++matched;
+        ++run;
+        score += 1 + 2 * (run - 1);
+        if (i == 0 || !text.at(i - 1).isLetterOrNumber())
+            score += 8;
+    }
+    return matched == patternSize ? qMax(score, 0) : -1;
+}
+
+int HistoryFilterModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return m_unfiltered ? m_history->rowCount() : m_rows.count();
+}
+
+QVariant HistoryFilterModel::data(const QModelIndex &index, int role) const
+{
+    if (index.row() >= rowCount() || index.column() != 0)
+        return QVariant();
+    if (role == Qt::DisplayRole || role == Qt::EditRole)
+        return m_history->entries().at(sourceRow(index.row()));
+    return QVariant();
+}
+
+bool HistoryFilterModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || row < 0 || count < 1 || row + count > rowCount())
+        return false;
+    QVector<int> rows;
+    for (int i = row; i < row + count; ++i)
+        rows.append(sourceRow(i));
+    // removing from the history refreshes this model, so start at the end
+    qSort(rows.begin(), rows.end(), qGreater<int>());
+    foreach (int sourceRow, rows)
+        m_history->removeRow(sourceRow);
+    return true;
+}
+
+void HistoryFilterModel::setPattern(const QString &pattern, Qt::CaseSensitivity cs)
+{
+    if (pattern == m_pattern && cs == m_caseSensitivity)
+        return;
+    // every match of pattern also matches a prefix of it
+    const bool narrow = !m_pattern.isEmpty() && cs == m_caseSensitivity
+            && pattern.startsWith(m_pattern, cs);
+    m_pattern = pattern;
+    m_caseSensitivity = cs;
+    filter(narrow);
+}
+
+void HistoryFilterModel::setFuzzy(bool fuzzy)
+{
+    if (fuzzy == m_fuzzy)
+        return;
+    m_fuzzy = fuzzy;
+    refresh();
+}
+
+void HistoryFilterModel::filter(bool narrow)
+{
+    beginResetModel();
+    m_unfiltered = m_pattern.isEmpty();
+    if (m_unfiltered) {
+        m_rows.clear();
+    } else if (!m_fuzzy) {
+        m_rows = m_history->prefixMatches(m_pattern, m_caseSensitivity);
+    } else {
+        const QString pattern = m_caseSensitivity == Qt::CaseInsensitive
+                ? m_pattern.toCaseFolded() : m_pattern;
+        const QStringList &list = m_history->entries();
+        const int candidateCount = narrow ? m_rows.count() : list.count();
+        // best scores first, in list order among equal scores
+        QVector<QPair<int, int> > scored;
+        for (int i = 0; i < candidateCount; ++i) {
+            const int row = narrow ? m_rows.at(i) : i;
+            const int score = fuzzyScore(list.at(row), pattern, m_caseSensitivity);
+            if (score >= 0)
+                scored.append(qMakePair(-score, row));
+        }
+        qSort(scored);
+        m_rows.resize(scored.count());
+        for (int i = 0; i < scored.count(); ++i)
+            m_rows[i] = scored.at(i).second;
+    }
+    endResetModel();
+}
+
+HistoryCompleterPrivate::~HistoryCompleterPrivate()
+{
+    if (store) {
+        store->removeFilter(filter);
+        store->release();
+    }
+    delete filter;
 }
 
 HistoryCompleter::HistoryCompleter(QLineEdit *lineEdit, const QString &historyKey, QObject *parent)
@@ -157,19 +783,23 @@ HistoryCompleter::HistoryCompleter(QLineEdit *lineEdit, const QString &historyKe
 {
     QTC_ASSERT(lineEdit, return);
     QTC_ASSERT(!historyKey.isEmpty(), return);
-    QTC_ASSERT(theSettings, return);
+    QTC_ASSERT(theSettings || theBinaryStore, return);
 
-    d->historyKey = QLatin1String("CompleterHistory/") + historyKey;
-    d->list = theSettings->value(d->historyKey).toStringList();
+    d->store = HistoryStore::acquire(historyKey);
     d->lineEdit = lineEdit;
-    if (d->list.count())
-        lineEdit->setText(d->list.at(0));
 
-    setModel(d);
-    setPopup(new HistoryLineView(d));
+    // the filter model does the filtering, see splitPath()
+    d->filter = new HistoryFilterModel(d->store);
+    d->store->addFilter(d->filter);
+    setModel(d->filter);
+    setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+    setPopup(new HistoryLineView(d->filter));
     lineEdit->installEventFilter(this);
 
     connect(lineEdit, SIGNAL(editingFinished()), this, SLOT(saveHistory()));
+    // a line edit that is shown already gets no further show event
+    if (lineEdit->isVisible())
+        restoreText();
 }
 
 HistoryCompleter::~HistoryCompleter()
@@ -179,6 +809,8 @@ HistoryCompleter::~HistoryCompleter()
 
 bool HistoryCompleter::eventFilter(QObject *obj, QEvent *event)
 {
+    if (event->type() == QEvent::Show && obj == d->lineEdit)
+        restoreText();
     if (event->type() == QEvent::KeyPress
             && static_cast<QKeyEvent *>(event)->key() == Qt::Key_Down
             && !popup()->isVisible()) {
@@ -188,34 +820,92 @@ bool HistoryCompleter::eventFilter(QObject *obj, QEvent *event)
     return QCompleter::eventFilter(obj, event);
 }
 
+/// Puts the latest entry into the line edit, once and only if it is empty
+void HistoryCompleter::restoreText()
+{
+    if (!d->textPending)
+        return;
+    d->textPending = false;
+    const QStringList &entries = d->store->entries();
+    if (d->lineEdit->text().isEmpty() && !entries.isEmpty())
+        d->lineEdit->setText(entries.at(0));
+}
+
+QStringList HistoryCompleter::splitPath(const QString &path) const
+{
+    // QCompleter asks for this whenever the completion prefix changes
+    if (d->filter)
+        d->filter->setPattern(path, caseSensitivity());
+    return QCompleter::splitPath(path);
+}
+
+bool HistoryCompleter::fuzzyMatching() const
+{
+    return d->filter && d->filter->isFuzzy();
+}
+
+void HistoryCompleter::setFuzzyMatching(bool fuzzy)
+{
+    QTC_ASSERT(d->filter, return);
+    d->filter->setFuzzy(fuzzy);
+}
+
+bool HistoryCompleter::usageRanking() const
+{
+    return d->store && d->store->isRanked();
+}
+
+void HistoryCompleter::setUsageRanking(bool ranking)
+{
+    QTC_ASSERT(d->store, return);
+    d->store->setRanked(ranking);
+}
+
 int HistoryCompleter::historySize() const
 {
-    return d->rowCount();
+    return d->store ? d->store->rowCount() : 0;
 }
 
 int HistoryCompleter::maximalHistorySize() const
 {
-    return d->maxLines;
+    return d->store ? d->store->maxLines : 0;
 }
 
 void HistoryCompleter::setMaximalHistorySize(int numberOfEntries)
 {
-    d->maxLines = numberOfEntries;
+    QTC_ASSERT(d->store, return);
+    d->store->maxLines = numberOfEntries;
 }
 
 void HistoryCompleter::clearHistory()
 {
-    d->clearHistory();
+    QTC_ASSERT(d->store, return);
+    d->store->clearHistory();
 }
 
 void HistoryCompleter::saveHistory()
 {
-    d->saveEntry(d->lineEdit->text());
+    d->store->saveEntry(d->lineEdit->text());
 }
 
 void HistoryCompleter::setSettings(QSettings *settings)
 {
+    // pending histories belong to the previous settings
+    if (theSettings)
+        flush();
     theSettings = settings;
 }
 
+void HistoryCompleter::setBinaryStore(BinaryStore *store)
+{
+    if (theSettings || theBinaryStore)
+        flush();
+    theBinaryStore = store;
+}
+
+void HistoryCompleter::flush()
+{
+    HistoryWriter::instance()->flush();
+}
+
 } // namespace Manhattan
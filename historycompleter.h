@@ -41,6 +41,8 @@ QT_END_NAMESPACE
 
 namespace Manhattan {
 
+class BinaryStore;
+
 class HistoryCompleterPrivate;
 
 class QTMANHATTANSTYLESHARED_EXPORT HistoryCompleter : public QCompleter
@@ -49,14 +51,34 @@ class QTMANHATTANSTYLESHARED_EXPORT HistoryCompleter : public QCompleter
 
 public:
     static void setSettings(QSettings *settings);
+    // Keeps the histories in store instead of the settings. The store
+    // must outlive the application object, see flush().
+    static void setBinaryStore(BinaryStore *store);
+    // Histories are written to the settings in the background shortly after
+    // they change. flush() writes pending changes and waits until they are
+    // stored; this also happens when the application object is destroyed.
+    static void flush();
+    // The history is read when it is first needed. The line edit shows the
+    // latest entry once it is visible, unless it got a text before.
     HistoryCompleter(QLineEdit *lineEdit, const QString &historyKey, QObject *parent = 0);
 
+    // Matches entries containing the typed characters in order instead of
+    // entries starting with them, best matches first
+    bool fuzzyMatching() const;
+    void setFuzzyMatching(bool fuzzy);
+    // Orders the history by use, counting recent uses more than older
+    // ones. This applies to all completers with the same history key.
+    bool usageRanking() const;
+    void setUsageRanking(bool ranking);
+
 private:
     ~HistoryCompleter();
     int historySize() const;
     int maximalHistorySize() const;
     void setMaximalHistorySize(int numberOfEntries);
     bool eventFilter(QObject *obj, QEvent *event);
+    void restoreText();
+    QStringList splitPath(const QString &path) const;
 
 public Q_SLOTS:
     void clearHistory();
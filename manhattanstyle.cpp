@@ -39,6 +39,7 @@
 #include "stylehelper.h"
 
 #include "fancymainwindow.h"
+#include "extensions/styleprofiler.h"
 
 #include <QApplication>
 #include <QComboBox>
@@ -144,6 +145,57 @@ bool hasProperty(const QWidget *widget, const QByteArray& name)
     return false;
 }
 
+// The status bar background only depends on its size and the base color
+static void drawStatusBarBackground(QPainter *painter, const QRect &rect)
+{
+    QLinearGradient grad(rect.topLeft(), QPoint(rect.center().x(), rect.bottom()));
+    QColor startColor = Utils::StyleHelper::shadowColor().darker(164);
+    QColor endColor = Utils::StyleHelper::baseColor().darker(130);
+    grad.setColorAt(0, startColor);
+    grad.setColorAt(1, endColor);
+    painter->fillRect(rect, grad);
+    painter->setPen(QColor(255, 255, 255, 60));
+    painter->drawLine(rect.topLeft() + QPoint(0,1),
+                      rect.topRight()+ QPoint(0,1));
+    painter->setPen(Utils::StyleHelper::borderColor().darker(110));
+    painter->drawLine(rect.topLeft(), rect.topRight());
+}
+
+static void drawToolBarBackground(QPainter *painter, const QRect &rect, const QRect &gradientSpan,
+                                  bool horizontal, bool drawLightColored, bool topBorder)
+{
+    if (horizontal)
+        Utils::StyleHelper::horizontalGradient(painter, gradientSpan, rect, drawLightColored);
+    else
+        Utils::StyleHelper::verticalGradient(painter, gradientSpan, rect, drawLightColored);
+
+    if (!drawLightColored)
+        painter->setPen(Utils::StyleHelper::borderColor());
+    else
+        painter->setPen(QColor(0x888888));
+
+    if (horizontal) {
+        // Note: This is a hack to determine if the
+        // toolbar should draw the top or bottom outline
+        // (needed for the find toolbar for instance)
+        QColor lighter(Utils::StyleHelper::sidebarHighlight());
+        if (drawLightColored)
+            lighter = QColor(255, 255, 255, 180);
+        if (topBorder) {
+            painter->drawLine(rect.topLeft(), rect.topRight());
+            painter->setPen(lighter);
+            painter->drawLine(rect.topLeft() + QPoint(0, 1), rect.topRight() + QPoint(0, 1));
+        } else {
+            painter->drawLine(rect.bottomLeft(), rect.bottomRight());
+            painter->setPen(lighter);
+            painter->drawLine(rect.topLeft(), rect.topRight());
+        }
+    } else {
+        painter->drawLine(rect.topLeft(), rect.bottomLeft());
+        painter->drawLine(rect.topRight(), rect.bottomRight());
+    }
+}
+
 class ManhattanStylePrivate
 {
 public:
@@ -170,6 +222,10 @@ ManhattanStyle::ManhattanStyle(const QString &baseStyleName)
     : QProxyStyle(QStyleFactory::create(baseStyleName)),
     d(new ManhattanStylePrivate())
 {
+    if (!qgetenv("MANHATTAN_STYLE_PROFILE").isEmpty())
+        StyleProfiler::setEnabled(true);
+    if (!qgetenv("MANHATTAN_STYLE_TRACE").isEmpty())
+        StyleTrace::setEnabled(true);
 }
 
 ManhattanStyle::~ManhattanStyle()
@@ -400,6 +456,7 @@ int ManhattanStyle::styleHint(StyleHint hint, const QStyleOption *option, const
 void ManhattanStyle::drawPrimitive(PrimitiveElement element, const QStyleOption *option,
                                    QPainter *painter, const QWidget *widget) const
 {
+    StyleProfiler::Scope profile(StyleProfiler::Primitive, element, widget);
     if (!panelWidget(widget))
         return QProxyStyle::drawPrimitive(element, option, painter, widget);
 
@@ -536,19 +593,25 @@ void ManhattanStyle::drawPrimitive(PrimitiveElement element, const QStyleOption
 
     case PE_PanelStatusBar:
         {
-            painter->save();
-            QLinearGradient grad(option->rect.topLeft(), QPoint(rect.center().x(), rect.bottom()));
-            QColor startColor = Utils::StyleHelper::shadowColor().darker(164);
-            QColor endColor = Utils::StyleHelper::baseColor().darker(130);
-            grad.setColorAt(0, startColor);
-            grad.setColorAt(1, endColor);
-            painter->fillRect(option->rect, grad);
-            painter->setPen(QColor(255, 255, 255, 60));
-            painter->drawLine(rect.topLeft() + QPoint(0,1),
-                              rect.topRight()+ QPoint(0,1));
-            painter->setPen(Utils::StyleHelper::borderColor().darker(110));
-            painter->drawLine(rect.topLeft(), rect.topRight());
-            painter->restore();
+            if (!Utils::StyleHelper::usePixmapCache()) {
+                painter->save();
+                drawStatusBarBackground(painter, rect);
+                painter->restore();
+                break;
+            }
+            QString key;
+            key.sprintf("mh_statusbar %d %d %d",
+                rect.width(), rect.height(), Utils::StyleHelper::baseColor().rgb());
+            QPixmap pixmap;
+            if (!QPixmapCache::find(key, pixmap)) {
+                pixmap = QPixmap(rect.size());
+                pixmap.fill(Qt::transparent);
+                QPainter p(&pixmap);
+                drawStatusBarBackground(&p, pixmap.rect());
+                p.end();
+                QPixmapCache::insert(key, pixmap);
+            }
+            painter->drawPixmap(rect.topLeft(), pixmap);
         }
         break;
 
@@ -634,6 +697,7 @@ void ManhattanStyle::drawPrimitive(PrimitiveElement element, const QStyleOption
 void ManhattanStyle::drawControl(ControlElement element, const QStyleOption *option,
                                  QPainter *painter, const QWidget *widget) const
 {
+    StyleProfiler::Scope profile(StyleProfiler::Control, element, widget);
     if (!panelWidget(widget))
         return QProxyStyle::drawControl(element, option, painter, widget);
 
@@ -802,46 +866,38 @@ void ManhattanStyle::drawControl(ControlElement element, const QStyleOption *opt
         {
             QRect rect = option->rect;
             bool horizontal = option->state & State_Horizontal;
-            rect = option->rect;
 
-            // Map offset for global window gradient
-            QPoint offset = widget->window()->mapToGlobal(option->rect.topLeft()) -
-                            widget->mapToGlobal(option->rect.topLeft());
+            // Map offset for global window gradient, the position of the
+            // window relative to the widget
             QRect gradientSpan;
             if (widget)
-                gradientSpan = QRect(offset, widget->window()->size());
+                gradientSpan = QRect(-widget->mapTo(widget->window(), QPoint(0, 0)), widget->window()->size());
 
             bool drawLightColored = lightColored(widget);
-            if (horizontal)
-                Utils::StyleHelper::horizontalGradient(painter, gradientSpan, rect, drawLightColored);
-            else
-                Utils::StyleHelper::verticalGradient(painter, gradientSpan, rect, drawLightColored);
-
-            if (!drawLightColored)
-                painter->setPen(Utils::StyleHelper::borderColor());
-            else
-                painter->setPen(QColor(0x888888));
+            bool topBorder = widget && widget->property("topBorder").toBool();
+            if (!Utils::StyleHelper::usePixmapCache()) {
+                drawToolBarBackground(painter, rect, gradientSpan, horizontal, drawLightColored, topBorder);
+                break;
+            }
 
-            if (horizontal) {
-                // Note: This is a hack to determine if the
-                // toolbar should draw the top or bottom outline
-                // (needed for the find toolbar for instance)
-                QColor lighter(Utils::StyleHelper::sidebarHighlight());
-                if (drawLightColored)
-                    lighter = QColor(255, 255, 255, 180);
-                if (widget && widget->property("topBorder").toBool()) {
-                    painter->drawLine(rect.topLeft(), rect.topRight());
-                    painter->setPen(lighter);
-                    painter->drawLine(rect.topLeft() + QPoint(0, 1), rect.topRight() + QPoint(0, 1));
-                } else {
-                    painter->drawLine(rect.bottomLeft(), rect.bottomRight());
-                    painter->setPen(lighter);
-                    painter->drawLine(rect.topLeft(), rect.topRight());
-                }
-            } else {
-                painter->drawLine(rect.topLeft(), rect.bottomLeft());
-                painter->drawLine(rect.topRight(), rect.bottomRight());
+            // The whole background including the border lines is cached,
+            // StyledBar repaints are a single blit
+            QString key;
+            key.sprintf("mh_toolbar %d %d %d %d %d %d %d %d %d %d",
+                rect.width(), rect.height(), gradientSpan.x(), gradientSpan.y(),
+                gradientSpan.width(), gradientSpan.height(), int(horizontal),
+                int(drawLightColored), int(topBorder),
+                Utils::StyleHelper::baseColor(drawLightColored).rgb());
+            QPixmap pixmap;
+            if (!QPixmapCache::find(key, pixmap)) {
+                pixmap = QPixmap(rect.size());
+                pixmap.fill(Qt::transparent);
+                QPainter p(&pixmap);
+                drawToolBarBackground(&p, pixmap.rect(), gradientSpan, horizontal, drawLightColored, topBorder);
+                p.end();
+                QPixmapCache::insert(key, pixmap);
             }
+            painter->drawPixmap(rect.topLeft(), pixmap);
         }
         break;
 
@@ -854,6 +910,7 @@ void ManhattanStyle::drawControl(ControlElement element, const QStyleOption *opt
 void ManhattanStyle::drawComplexControl(ComplexControl control, const QStyleOptionComplex *option,
                                         QPainter *painter, const QWidget *widget) const
 {
+    StyleProfiler::Scope profile(StyleProfiler::ComplexControl, control, widget);
     if (!panelWidget(widget))
          return     QProxyStyle::drawComplexControl(control, option, painter, widget);
 
@@ -30,6 +30,7 @@
 #include "progressbar.h"
 
 #include "stylehelper.h"
+#include "extensions/pixelratio_p.h"
 
 #include <QPropertyAnimation>
 #include <QPainter>
@@ -37,6 +38,7 @@
 #include <QBrush>
 #include <QColor>
 #include <QMouseEvent>
+#include <QTimerEvent>
 
 using namespace Manhattan;
 
@@ -44,7 +46,9 @@ using namespace Manhattan;
 #define CANCELBUTTON_SIZE 15
 
 ProgressBar::ProgressBar(QWidget *parent)
-    : QWidget(parent), m_error(false), m_minimum(1), m_maximum(100), m_value(1), m_cancelButtonFader(0), m_finished(false)
+    : QWidget(parent), m_error(false), m_progressHeight(PROGRESSBAR_HEIGHT), m_minimum(1), m_maximum(100), m_value(1),
+      m_cancelButtonFader(0), m_finished(false), m_cancelButtonHover(false), m_layoutValid(false),
+      m_chromeDevicePixelRatio(1)
 {
     setSizePolicy(QSizePolicy::Minimum, QSizePolicy::Fixed);
     setMouseTracking(true);
@@ -59,6 +63,8 @@ bool ProgressBar::event(QEvent *e)
     switch(e->type()) {
     case QEvent::Enter:
         {
+            updateLayout();
+            setCancelButtonHover(m_cancelRect.contains(mapFromGlobal(QCursor::pos())));
             QPropertyAnimation *animation = new QPropertyAnimation(this, "cancelButtonFader");
             animation->setDuration(125);
             animation->setEndValue(1.0);
@@ -67,6 +73,7 @@ bool ProgressBar::event(QEvent *e)
         break;
     case QEvent::Leave:
         {
+            setCancelButtonHover(false);
             QPropertyAnimation *animation = new QPropertyAnimation(this, "cancelButtonFader");
             animation->setDuration(225);
             animation->setEndValue(0.0);
@@ -79,11 +86,49 @@ bool ProgressBar::event(QEvent *e)
     return false;
 }
 
+void ProgressBar::setCancelButtonFader(float value)
+{
+    m_cancelButtonFader = value;
+    if (m_layoutValid)
+        update(m_cancelRect);
+    else
+        update();
+}
+
+void ProgressBar::setProgressSink(ProgressSink *sink)
+{
+    m_sampler.setSink(sink, this);
+    sampleProgressSink();
+}
+
+void ProgressBar::sampleProgressSink()
+{
+    int minimum;
+    int maximum;
+    int value;
+    if (!m_sampler.sample(&minimum, &maximum, &value))
+        return;
+    if (minimum != m_minimum || maximum != m_maximum)
+        setRange(minimum, maximum);
+    const QRect oldFill = fillRect();
+    const int oldValue = m_value;
+    setValue(value);
+    if (m_value != oldValue && m_layoutValid && fillRect() == oldFill)
+        m_sampler.addDroppedUpdate();
+}
+
+void ProgressBar::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == m_sampler.timerId())
+        sampleProgressSink();
+    else
+        QWidget::timerEvent(event);
+}
 
 void ProgressBar::reset()
 {
     m_value = m_minimum;
-    update();
+    updateBar();
 }
 
 void ProgressBar::setRange(int minimum, int maximum)
@@ -92,7 +137,7 @@ void ProgressBar::setRange(int minimum, int maximum)
     m_maximum = maximum;
     if (m_value < m_minimum || m_value > m_maximum)
         m_value = m_minimum;
-    update();
+    updateBar();
 }
 
 void ProgressBar::setValue(int value)
@@ -102,8 +147,26 @@ void ProgressBar::setValue(int value)
             || m_value > m_maximum) {
         return;
     }
+    if (!m_layoutValid) {
+        m_value = value;
+        update();
+        return;
+    }
+    // The shadow line and the cancel button depend on these
+    const bool wasRunning = m_value > 0 && m_value < m_maximum;
+    const bool wasCancelable = m_value < m_maximum;
+    const int oldRight = fillRect().right();
     m_value = value;
-    update();
+    if (wasRunning != (m_value > 0 && m_value < m_maximum) || wasCancelable != (m_value < m_maximum)) {
+        update(m_barRect);
+        return;
+    }
+    const int newRight = fillRect().right();
+    if (newRight == oldRight)
+        return;
+    // Only the part of the fill that changed, with the shadow right of it
+    update(QRect(QPoint(qMin(oldRight, newRight), m_innerRect.top()),
+                 QPoint(qMax(oldRight, newRight) + 2, m_innerRect.bottom())));
 }
 
 void ProgressBar::setFinished(bool b)
@@ -111,7 +174,7 @@ void ProgressBar::setFinished(bool b)
     if (b == m_finished)
         return;
     m_finished = b;
-    update();
+    updateBar();
 }
 
 QString ProgressBar::title() const
@@ -127,13 +190,13 @@ bool ProgressBar::hasError() const
 void ProgressBar::setTitle(const QString &title)
 {
     m_title = title;
-    update();
+    invalidateLayout();
 }
 
 void ProgressBar::setError(bool on)
 {
     m_error = on;
-    update();
+    updateBar();
 }
 
 QSize ProgressBar::sizeHint() const
@@ -146,105 +209,157 @@ QSize ProgressBar::sizeHint() const
 
 namespace { const int INDENT = 6; }
 
-void ProgressBar::mousePressEvent(QMouseEvent *event)
+void ProgressBar::invalidateLayout()
 {
-    QFont boldFont(font());
-    boldFont.setPointSizeF(Utils::StyleHelper::sidebarFontSize());
-    boldFont.setBold(true);
-    QFontMetrics fm(boldFont);
-    int h = fm.height();
-    QRect rect(INDENT - 1, h+8, size().width()-2*INDENT + 1, m_progressHeight-1);
-    QRect cancelRect(rect.adjusted(rect.width() - CANCELBUTTON_SIZE, 1, -1, 0));
-
-    if (event->modifiers() == Qt::NoModifier
-        && cancelRect.contains(event->pos())) {
-        event->accept();
-        emit clicked();
-        return;
-    }
-    QWidget::mousePressEvent(event);
+    m_layoutValid = false;
+    m_chrome = QPixmap();
+    update();
 }
 
-void ProgressBar::mouseMoveEvent(QMouseEvent *)
+void ProgressBar::updateBar()
 {
-    update();
+    if (m_layoutValid)
+        update(m_barRect);
+    else
+        update();
 }
 
-void ProgressBar::paintEvent(QPaintEvent *)
+void ProgressBar::updateLayout()
 {
     // TODO move font into Utils::StyleHelper
     // TODO use Utils::StyleHelper white
+    const qreal pixelRatio = chromePixelRatio(this);
+    if (m_layoutValid && m_chromeDevicePixelRatio == pixelRatio)
+        return;
+    m_layoutValid = true;
+    m_chromeDevicePixelRatio = pixelRatio;
 
     if (bar.isNull())
         bar.load(QLatin1String(":/core/images/progressbar.png"));
 
-    double range = maximum() - minimum();
-    double percent = 0.;
-    if (range != 0)
-        percent = (value() - minimum()) / range;
-    if (percent > 1)
-        percent = 1;
-    else if (percent < 0)
-        percent = 0;
-
-    if (finished())
-        percent = 1;
-
-    QPainter p(this);
-    QFont boldFont(p.font());
+    QFont boldFont(font());
     boldFont.setPointSizeF(Utils::StyleHelper::sidebarFontSize());
     boldFont.setBold(true);
-    p.setFont(boldFont);
     QFontMetrics fm(boldFont);
+    int h = fm.height();
+
+    m_progressHeight = PROGRESSBAR_HEIGHT;
+    m_progressHeight += ((m_progressHeight % 2) + 1) % 2; // make odd
+    m_barRect = QRect(INDENT - 1, h+6, size().width()-2*INDENT + 1, m_progressHeight-1);
+    m_innerRect = m_barRect.adjusted(3, 2, -2, -2);
+    m_cancelRect = m_barRect.adjusted(m_barRect.width() - CANCELBUTTON_SIZE, 1, -1, 0);
+
+    // If there is not enough room when centered, we left align and
+    // elide the text
+    int textSpace = rect().width() - 8;
+    m_elidedTitle = fm.elidedText(m_title, Qt::ElideRight, textSpace);
+
+    m_chrome = createChromePixmap(size(), pixelRatio);
+    QPainter p(&m_chrome);
+    p.setFont(boldFont);
 
     // Draw separator
-    int h = fm.height();
     p.setPen(Utils::StyleHelper::sidebarShadow());
     p.drawLine(0,0, size().width(), 0);
 
     p.setPen(Utils::StyleHelper::sidebarHighlight());
     p.drawLine(1, 1, size().width(), 1);
 
-    QRect textBounds = fm.boundingRect(m_title);
-    textBounds.moveCenter(rect().center());
     int alignment = Qt::AlignHCenter;
-
-    int textSpace = rect().width() - 8;
-    // If there is not enough room when centered, we left align and
-    // elide the text
-    QString elidedtitle  = fm.elidedText(m_title, Qt::ElideRight, textSpace);
-
     QRect textRect = rect().adjusted(3, 1, -3, 0);
     textRect.setHeight(h+5);
 
     p.setPen(QColor(0, 0, 0, 120));
-    p.drawText(textRect, alignment | Qt::AlignBottom, elidedtitle);
+    p.drawText(textRect, alignment | Qt::AlignBottom, m_elidedTitle);
     p.translate(0, -1);
     p.setPen(Utils::StyleHelper::panelTextColor());
-    p.drawText(textRect, alignment | Qt::AlignBottom, elidedtitle);
+    p.drawText(textRect, alignment | Qt::AlignBottom, m_elidedTitle);
     p.translate(0, 1);
 
-    m_progressHeight = PROGRESSBAR_HEIGHT;
-    m_progressHeight += ((m_progressHeight % 2) + 1) % 2; // make odd
     // draw outer rect
-    QRect rect(INDENT - 1, h+6, size().width()-2*INDENT + 1, m_progressHeight-1);
     p.setPen(Utils::StyleHelper::panelTextColor());
-    Utils::StyleHelper::drawCornerImage(bar, &p, rect, 2, 2, 2, 2);
+    Utils::StyleHelper::drawCornerImage(bar, &p, m_barRect, 2, 2, 2, 2);
+}
+
+QRect ProgressBar::fillRect() const
+{
+    double range = maximum() - minimum();
+    double percent = 0.;
+    if (range != 0)
+        percent = (value() - minimum()) / range;
+    if (percent > 1)
+        percent = 1;
+    else if (percent < 0)
+        percent = 0;
+
+    if (finished())
+        percent = 1;
+
+    QRect inner = m_innerRect;
+    inner.adjust(0, 0, qRound((percent - 1) * inner.width()), 0);
+    // avoid too small red bar
+    if (m_error && inner.width() < 10)
+        inner.adjust(0, 0, 10 - inner.width(), 0);
+    return inner;
+}
+
+void ProgressBar::setCancelButtonHover(bool hover)
+{
+    if (hover == m_cancelButtonHover)
+        return;
+    m_cancelButtonHover = hover;
+    if (m_layoutValid)
+        update(m_cancelRect);
+}
+
+void ProgressBar::resizeEvent(QResizeEvent *event)
+{
+    invalidateLayout();
+    QWidget::resizeEvent(event);
+}
+
+void ProgressBar::changeEvent(QEvent *event)
+{
+    if (event->type() == QEvent::FontChange || event->type() == QEvent::StyleChange)
+        invalidateLayout();
+    QWidget::changeEvent(event);
+}
+
+void ProgressBar::mousePressEvent(QMouseEvent *event)
+{
+    updateLayout();
+    if (event->modifiers() == Qt::NoModifier
+        && m_cancelRect.contains(event->pos())) {
+        event->accept();
+        emit clicked();
+        return;
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void ProgressBar::mouseMoveEvent(QMouseEvent *event)
+{
+    // Only the cancel button changes with the mouse
+    updateLayout();
+    setCancelButtonHover(m_cancelRect.contains(event->pos()));
+}
+
+void ProgressBar::paintEvent(QPaintEvent *)
+{
+    updateLayout();
+
+    QPainter p(this);
+    p.drawPixmap(0, 0, m_chrome);
 
     // draw inner rect
     QColor c = Utils::StyleHelper::panelTextColor();
     c.setAlpha(180);
     p.setPen(Qt::NoPen);
 
-
-    QRect inner = rect.adjusted(3, 2, -2, -2);
-    inner.adjust(0, 0, qRound((percent - 1) * inner.width()), 0);
+    QRect inner = fillRect();
     if (m_error) {
         QColor red(255, 60, 0, 210);
         c = red;
-        // avoid too small red bar
-        if (inner.width() < 10)
-            inner.adjust(0, 0, 10 - inner.width(), 0);
     } else if (m_finished) {
         c = QColor(90, 170, 60);
     }
@@ -275,8 +390,8 @@ void ProgressBar::paintEvent(QPaintEvent *)
     p.setOpacity(m_cancelButtonFader);
 
     if (value() < maximum() && !m_error) {
-        QRect cancelRect(rect.adjusted(rect.width() - CANCELBUTTON_SIZE, 1, -1, 0));
-        bool hover = cancelRect.contains(mapFromGlobal(QCursor::pos()));
+        const QRect cancelRect = m_cancelRect;
+        bool hover = m_cancelButtonHover;
         QLinearGradient grad(cancelRect.topLeft(), cancelRect.bottomLeft());
         int intensity = hover ? 90 : 70;
         QColor buttonColor(intensity, intensity, intensity, 255);
@@ -31,6 +31,8 @@
 #define PROGRESSPIE_H
 
 #include "qt-manhattan-style_global.hpp"
+#include "extensions/progresssink.h"
+#include <QPixmap>
 #include <QString>
 #include <QWidget>
 
@@ -62,16 +64,34 @@ public:
     void setValue(int value);
     void setFinished(bool b);
     float cancelButtonFader() { return m_cancelButtonFader; }
-    void setCancelButtonFader(float value) { update(); m_cancelButtonFader= value;}
+    void setCancelButtonFader(float value);
     bool event(QEvent *);
 
+    // Samples sink once per frame instead of taking every value written
+    // to it. Pass 0 to stop, the sink must outlive the bar otherwise.
+    void setProgressSink(ProgressSink *sink);
+    ProgressSink *progressSink() const { return m_sampler.sink(); }
+    // See ProgressSink::Sampler
+    int coalescedUpdates() const { return m_sampler.coalescedUpdates(); }
+    int droppedUpdates() const { return m_sampler.droppedUpdates(); }
+
 signals:
     void clicked();
 
 protected:
     void mousePressEvent(QMouseEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void changeEvent(QEvent *event);
+    void timerEvent(QTimerEvent *event);
 
 private:
+    void invalidateLayout();
+    void updateLayout();
+    void updateBar();
+    QRect fillRect() const;
+    void setCancelButtonHover(bool hover);
+    void sampleProgressSink();
+
     QImage bar;
     QString m_text;
     QString m_title;
@@ -82,6 +102,18 @@ private:
     int m_value;
     float m_cancelButtonFader;
     bool m_finished;
+    bool m_cancelButtonHover;
+    // Geometry, the elided title and the separator, title and frame
+    // rendered into m_chrome, kept until the size, title, font or device
+    // pixel ratio change
+    bool m_layoutValid;
+    QString m_elidedTitle;
+    QPixmap m_chrome;
+    qreal m_chromeDevicePixelRatio;
+    QRect m_barRect;
+    QRect m_innerRect;
+    QRect m_cancelRect;
+    ProgressSink::Sampler m_sampler;
 };
 
 } // namespace Manhattan
@@ -7,6 +7,12 @@
 QT += core gui
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
+# ProgressSink needs the 64 bit atomics of Qt 5.3, StyleTrace the fences
+# of C++11
+lessThan(QT_MAJOR_VERSION, 5): error("qt-manhattan-style needs Qt 5.3 or later")
+equals(QT_MAJOR_VERSION, 5):lessThan(QT_MINOR_VERSION, 3): error("qt-manhattan-style needs Qt 5.3 or later")
+CONFIG += c++11
+
 # The code still used some deprecated stuff
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x040900
 
@@ -34,7 +40,13 @@ SOURCES += \
     fancyactionbar.cpp \
     doubletabwidget.cpp \
     extensions/simpleprogressbar.cpp \
+    extensions/binarystore.cpp \
+    extensions/progresssink.cpp \
+    extensions/multiprogresswidget.cpp \
+    extensions/styleprofiler.cpp \
+    extensions/styletrace.cpp \
     extensions/tabwidget.cpp \
+    extensions/taboverflowpopup.cpp \
     extensions/threelevelsitempicker.cpp
 
 HEADERS +=\
@@ -57,7 +69,15 @@ HEADERS +=\
     coreconstants.h \
     qt-manhattan-style_global.hpp \
     extensions/simpleprogressbar.h \
+    extensions/binarystore.h \
+    extensions/progresssink.h \
+    extensions/multiprogresswidget.h \
+    extensions/styleprofiler.h \
+    extensions/styletrace.h \
     extensions/tabwidget.h \
+    extensions/pixelratio_p.h \
+    extensions/tablayout_p.h \
+    extensions/taboverflowpopup.h \
     extensions/threelevelsitempicker.h
 
 unix:!symbian {
@@ -76,4 +96,6 @@ RESOURCES += \
     resources/resources.qrc
 
 OTHER_FILES += \
-    CMakeLists.txt
+    CMakeLists.txt \
+    tests/CMakeLists.txt \
+    tests/tests.pro
@@ -33,61 +33,99 @@
 #include <QStringList>
 #include <QFileInfo>
 #include <QDir>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
 
-#include <limits.h>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define MANHATTAN_HAVE_SSE2
+#  include <emmintrin.h>
+#endif
 
 namespace Manhattan {
 
-QTMANHATTANSTYLESHARED_EXPORT QString settingsKey(const QString &category)
+// settingsKey() forgets its keys when it has this many
+static const int SETTINGS_KEY_CACHE_SIZE = 512;
+
+static inline bool isKeyCharacter(QChar c)
+{
+    const ushort u = c.unicode();
+    if (u < 0x80)
+        return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z')
+                || (u >= '0' && u <= '9') || u == '_';
+    return c.isLetterOrNumber();
+}
+
+static QString createSettingsKey(const QString &category)
 {
     QString rc(category);
     const QChar underscore = QLatin1Char('_');
     // Remove the sort category "X.Category" -> "Category"
     if (rc.size() > 2 && rc.at(0).isLetter() && rc.at(1) == QLatin1Char('.'))
         rc.remove(0, 2);
-    // Replace special characters
+    // Replace special characters, rc is only detached when there are any
     const int size = rc.size();
     for (int i = 0; i < size; i++) {
-        const QChar c = rc.at(i);
-        if (!c.isLetterOrNumber() && c != underscore)
+        if (!isKeyCharacter(rc.at(i)))
             rc[i] = underscore;
     }
     return rc;
 }
 
+QTMANHATTANSTYLESHARED_EXPORT QString settingsKey(const QString &category)
+{
+    // Keys are interned, every call for a category returns a shared copy
+    static QMutex mutex;
+    static QHash<QString, QString> keys;
+    QMutexLocker locker(&mutex);
+    QHash<QString, QString>::const_iterator it = keys.constFind(category);
+    if (it != keys.constEnd())
+        return it.value();
+    if (keys.size() >= SETTINGS_KEY_CACHE_SIZE)
+        keys.clear();
+    return keys.insert(category, createSettingsKey(category)).value();
+}
+
 // Figure out length of common start of string ("C:\a", "c:\b"  -> "c:\"
-static inline int commonPartSize(const QString &s1, const QString &s2)
+QTMANHATTANSTYLESHARED_EXPORT int commonPrefixLength(const QString &s1, const QString &s2, int maxLength)
 {
-    const int size = qMin(s1.size(), s2.size());
-    for (int i = 0; i < size; i++)
-        if (s1.at(i) != s2.at(i))
+    const int size = qMin(maxLength, qMin(s1.size(), s2.size()));
+    const ushort *p1 = s1.utf16();
+    const ushort *p2 = s2.utf16();
+    // implicitly shared copies
+    if (p1 == p2)
+        return size;
+    int i = 0;
+#ifdef MANHATTAN_HAVE_SSE2
+    // Compare 8 UTF-16 code units at once, the block with the
+    // mismatch is searched below
+    for ( ; i + 8 <= size; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p1 + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p2 + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(a, b)) != 0xffff)
+            break;
+    }
+#endif
+    for ( ; i < size; i++)
+        if (p1[i] != p2[i])
             return i;
     return size;
 }
 
 QTMANHATTANSTYLESHARED_EXPORT QString commonPrefix(const QStringList &strings)
 {
-    switch (strings.size()) {
-    case 0:
-        return QString();
-    case 1:
-        return strings.front();
-    default:
-        break;
-    }
     // Figure out common string part: "C:\foo\bar1" "C:\foo\bar2"  -> "C:\foo\bar"
-    int commonLength = INT_MAX;
-    const int last = strings.size() - 1;
-    for (int i = 0; i < last; i++)
-        commonLength = qMin(commonLength, commonPartSize(strings.at(i), strings.at(i + 1)));
-    if (!commonLength)
-        return QString();
-    return strings.at(0).left(commonLength);
+    return commonPrefix(strings.constBegin(), strings.constEnd());
 }
 
 QTMANHATTANSTYLESHARED_EXPORT QString commonPath(const QStringList &files)
 {
-    QString common = commonPrefix(files);
+    return commonPathOfPrefix(commonPrefix(files));
+}
+
+QTMANHATTANSTYLESHARED_EXPORT QString commonPathOfPrefix(const QString &prefix)
+{
+    QString common = prefix;
     // Find common directory part: "C:\foo\bar" -> "C:\foo"
     int lastSeparatorPos = common.lastIndexOf(QLatin1Char('/'));
     if (lastSeparatorPos == -1)
@@ -102,21 +140,98 @@ QTMANHATTANSTYLESHARED_EXPORT QString commonPath(const QStringList &files)
     return common;
 }
 
+#ifndef Q_OS_WIN
+// number of absolute, not clean paths withTildeHomePath() remembers
+static const int TILDE_PATH_CACHE_SIZE = 1000;
+
+// Whether QDir::cleanPath() and QFileInfo::absoluteFilePath() would
+// return path unchanged: absolute, no empty, "." or ".." components
+// and no trailing separator.
+static bool isCleanAbsolutePath(const QString &path)
+{
+    const int size = path.size();
+    if (!size || path.at(0) != QLatin1Char('/'))
+        return false;
+    const QChar *p = path.constData();
+    for (int i = 0; i < size; ++i) {
+        if (p[i] != QLatin1Char('/'))
+            continue;
+        if (i + 1 == size)
+            return size == 1;
+        if (p[i + 1] == QLatin1Char('/'))
+            return false;
+        if (p[i + 1] == QLatin1Char('.')) {
+            if (i + 2 == size || p[i + 2] == QLatin1Char('/'))
+                return false;
+            if (p[i + 2] == QLatin1Char('.') && (i + 3 == size || p[i + 3] == QLatin1Char('/')))
+                return false;
+        }
+    }
+    return true;
+}
+
+static QString tildeHomePath(const QString &path, const QString &absolutePath)
+{
+    static const QString homePath = QDir::homePath();
+    if (absolutePath.startsWith(homePath))
+        return QLatin1Char('~') + absolutePath.mid(homePath.size());
+    return path;
+}
+
+// Relative paths depend on the current directory and are not cached
+static QString tildeHomePathLocked(QCache<QString, QString> &cache, const QString &path)
+{
+    if (isCleanAbsolutePath(path))
+        return tildeHomePath(path, path);
+    const bool cacheable = path.startsWith(QLatin1Char('/'));
+    if (cacheable) {
+        if (const QString *outPath = cache.object(path))
+            return *outPath;
+    }
+    const QString outPath = tildeHomePath(path, QFileInfo(QDir::cleanPath(path)).absoluteFilePath());
+    if (cacheable)
+        cache.insert(path, new QString(outPath));
+    return outPath;
+}
+
+static QMutex *tildePathCacheMutex()
+{
+    static QMutex mutex;
+    return &mutex;
+}
+
+static QCache<QString, QString> &tildePathCache()
+{
+    static QCache<QString, QString> cache(TILDE_PATH_CACHE_SIZE);
+    return cache;
+}
+#endif
+
 QTMANHATTANSTYLESHARED_EXPORT QString withTildeHomePath(const QString &path)
 {
 #ifdef Q_OS_WIN
-    QString outPath = path;
+    return path;
 #else
-    static const QString homePath = QDir::homePath();
+    if (isCleanAbsolutePath(path))
+        return tildeHomePath(path, path);
+    QMutexLocker locker(tildePathCacheMutex());
+    return tildeHomePathLocked(tildePathCache(), path);
+#endif
+}
 
-    QFileInfo fi(QDir::cleanPath(path));
-    QString outPath = fi.absoluteFilePath();
-    if (outPath.startsWith(homePath))
-        outPath = QLatin1Char('~') + outPath.mid(homePath.size());
-    else
-        outPath = path;
+QTMANHATTANSTYLESHARED_EXPORT QStringList withTildeHomePaths(const QStringList &paths)
+{
+#ifdef Q_OS_WIN
+    return paths;
+#else
+    QStringList outPaths;
+    outPaths.reserve(paths.size());
+    QMutexLocker locker(tildePathCacheMutex());
+    QCache<QString, QString> &cache = tildePathCache();
+    foreach (const QString &path, paths)
+        outPaths.append(tildeHomePathLocked(cache, path));
+    return outPaths;
 #endif
-    return outPath;
 }
 
 int AbstractQtcMacroExpander::findMacro(const QString &str, int *pos, QString *ret)
@@ -157,4 +272,59 @@ QTMANHATTANSTYLESHARED_EXPORT QString expandMacros(const QString &str, AbstractM
     return ret;
 }
 
+MacroTemplate::MacroTemplate(const QString &str)
+    : m_source(str)
+{
+    for (int openPos = str.indexOf(QLatin1String("%{")); openPos >= 0;
+         openPos = str.indexOf(QLatin1String("%{"), openPos + 2)) {
+        const int varPos = openPos + 2;
+        const int closePos = str.indexOf(QLatin1Char('}'), varPos);
+        // no later "%{" can be closed either
+        if (closePos < 0)
+            break;
+        Macro macro;
+        macro.openPos = openPos;
+        macro.closePos = closePos;
+        macro.name = str.mid(varPos, closePos - varPos);
+        m_macros.append(macro);
+    }
+}
+
+QString MacroTemplate::expand(AbstractQtcMacroExpander *mx) const
+{
+    if (m_macros.isEmpty())
+        return m_source;
+
+    // Resolve first, so the result can be allocated at its final size
+    QVector<int> resolved;
+    QVector<QString> replacements;
+    int size = m_source.size();
+    int pos = 0;
+    QString ret;
+    for (int i = 0; i < m_macros.size(); ++i) {
+        const Macro &macro = m_macros.at(i);
+        // part of an expando that was replaced already
+        if (macro.openPos < pos)
+            continue;
+        if (mx->resolveMacro(macro.name, &ret)) {
+            resolved.append(i);
+            replacements.append(ret);
+            size += ret.size() - (macro.closePos + 1 - macro.openPos);
+            pos = macro.closePos + 1;
+        }
+    }
+
+    ret.clear();
+    ret.reserve(size);
+    pos = 0;
+    for (int i = 0; i < resolved.size(); ++i) {
+        const Macro &macro = m_macros.at(resolved.at(i));
+        ret += m_source.midRef(pos, macro.openPos - pos);
+        ret += replacements.at(i);
+        pos = macro.closePos + 1;
+    }
+    ret += m_source.midRef(pos);
+    return ret;
+}
+
 } // namespace Manhattan
@@ -32,6 +32,9 @@
 
 #include "qt-manhattan-style_global.hpp"
 
+#include <QString>
+#include <QVector>
+
 QT_BEGIN_NAMESPACE
 class QStringList;
 QT_END_NAMESPACE
@@ -40,20 +43,53 @@ namespace Manhattan {
 
 // Create a usable settings key from a category,
 // for example Editor|C++ -> Editor_C__
+// Keys are cached, repeated calls return a shared copy.
 QTMANHATTANSTYLESHARED_EXPORT QString settingsKey(const QString &category);
 
+// Return the length of the common start of s1 and s2, at most maxLength
+QTMANHATTANSTYLESHARED_EXPORT int commonPrefixLength(const QString &s1, const QString &s2, int maxLength);
+
 // Return the common prefix part of a string list:
 // "C:\foo\bar1" "C:\foo\bar2"  -> "C:\foo\bar"
 QTMANHATTANSTYLESHARED_EXPORT QString commonPrefix(const QStringList &strings);
 
+// Same for a range of strings, for containers other than QStringList
+template <typename Iterator>
+QString commonPrefix(Iterator begin, Iterator end)
+{
+    if (begin == end)
+        return QString();
+    const QString &first = *begin;
+    // Every string only needs to be compared as far as all previous ones match
+    int commonLength = first.size();
+    for (Iterator it = begin; commonLength && ++it != end; )
+        commonLength = commonPrefixLength(first, *it, commonLength);
+    if (!commonLength)
+        return QString();
+    return first.left(commonLength);
+}
+
 // Return the common path of a list of files:
 // "C:\foo\bar1" "C:\foo\bar2"  -> "C:\foo"
 QTMANHATTANSTYLESHARED_EXPORT QString commonPath(const QStringList &files);
 
+// Return the directory part of a common prefix: "C:\foo\bar" -> "C:\foo"
+QTMANHATTANSTYLESHARED_EXPORT QString commonPathOfPrefix(const QString &prefix);
+
+template <typename Iterator>
+QString commonPath(Iterator begin, Iterator end)
+{
+    return commonPathOfPrefix(commonPrefix(begin, end));
+}
+
 // On Linux/Mac replace user's home path with ~
 // Uses cleaned path and tries to use absolute path of "path" if possible
 // If path is not sub of home path, or when running on Windows, returns the input
+// Absolute paths which are already clean are converted without touching
+// the file system, other absolute paths are cached.
 QTMANHATTANSTYLESHARED_EXPORT QString withTildeHomePath(const QString &path);
+// Same for a list of paths, in one pass
+QTMANHATTANSTYLESHARED_EXPORT QStringList withTildeHomePaths(const QStringList &paths);
 
 class QTMANHATTANSTYLESHARED_EXPORT AbstractMacroExpander {
 public:
@@ -80,6 +116,31 @@ public:
 QTMANHATTANSTYLESHARED_EXPORT void expandMacros(QString *str, AbstractMacroExpander *mx);
 QTMANHATTANSTYLESHARED_EXPORT QString expandMacros(const QString &str, AbstractMacroExpander *mx);
 
+// A string parsed once into literal text and %{name} expandos, to be
+// expanded many times, possibly with different expanders. expand() gives
+// the same result as expandMacros() with an AbstractQtcMacroExpander,
+// including expandos nested into ones that do not resolve.
+class QTMANHATTANSTYLESHARED_EXPORT MacroTemplate {
+public:
+    MacroTemplate() {}
+    explicit MacroTemplate(const QString &str);
+
+    QString source() const { return m_source; }
+    bool hasMacros() const { return !m_macros.isEmpty(); }
+    QString expand(AbstractQtcMacroExpander *mx) const;
+
+private:
+    // Every "%{" with a closing '}', the candidates findMacro() would try
+    struct Macro {
+        int openPos;
+        int closePos;
+        QString name;
+    };
+
+    QString m_source;
+    QVector<Macro> m_macros;
+};
+
 } // namespace Manhattan
 
 #endif // SETTINGSTUTILS_H
@@ -28,6 +28,7 @@
 ****************************************************************************/
 
 #include "styleanimator.h"
+#include "extensions/styletrace.h"
 
 #include <QStyleOption>
 
@@ -114,6 +115,7 @@ void Transition::paint(QPainter *painter, const QStyleOption *option)
 
 void StyleAnimator::timerEvent(QTimerEvent *)
 {
+    Manhattan::StyleTrace::Scope trace("animator", "StyleAnimator::timerEvent");
     for (int i = animations.size() - 1 ; i >= 0 ; --i) {
         if (animations[i]->widget())
             animations[i]->widget()->update();
@@ -28,6 +28,7 @@
 ****************************************************************************/
 
 #include "stylehelper.h"
+#include "extensions/styletrace.h"
 
 #include <QPixmapCache>
 #include <QWidget>
@@ -179,6 +180,7 @@ static void verticalGradientHelper(QPainter *p, const QRect &spanRect, const QRe
 void StyleHelper::verticalGradient(QPainter *painter, const QRect &spanRect, const QRect &clipRect, bool lightColored)
 {
     if (StyleHelper::usePixmapCache()) {
+        StyleTrace::Scope trace("cache", "StyleHelper::verticalGradient", -1, 0, StyleTrace::CacheHit);
         QString key;
         QColor keyColor = baseColor(lightColored);
         key.sprintf("mh_vertical %d %d %d %d %d",
@@ -187,6 +189,7 @@ void StyleHelper::verticalGradient(QPainter *painter, const QRect &spanRect, con
 
         QPixmap pixmap;
         if (!QPixmapCache::find(key, pixmap)) {
+            trace.setCacheResult(StyleTrace::CacheMiss);
             pixmap = QPixmap(clipRect.size());
             QPainter p(&pixmap);
             QRect rect(0, 0, clipRect.width(), clipRect.height());
@@ -237,6 +240,7 @@ QRect &rect, bool lightColored)
 void StyleHelper::horizontalGradient(QPainter *painter, const QRect &spanRect, const QRect &clipRect, bool lightColored)
 {
     if (StyleHelper::usePixmapCache()) {
+        StyleTrace::Scope trace("cache", "StyleHelper::horizontalGradient", -1, 0, StyleTrace::CacheHit);
         QString key;
         QColor keyColor = baseColor(lightColored);
         key.sprintf("mh_horizontal %d %d %d %d %d %d",
@@ -245,6 +249,7 @@ void StyleHelper::horizontalGradient(QPainter *painter, const QRect &spanRect, c
 
         QPixmap pixmap;
         if (!QPixmapCache::find(key, pixmap)) {
+            trace.setCacheResult(StyleTrace::CacheMiss);
             pixmap = QPixmap(clipRect.size());
             QPainter p(&pixmap);
             QRect rect = QRect(0, 0, clipRect.width(), clipRect.height());
@@ -274,6 +279,7 @@ void StyleHelper::drawArrow(QStyle::PrimitiveElement element, QPainter *painter,
     // From windowsstyle but modified to enable AA
     if (option->rect.width() <= 1 || option->rect.height() <= 1)
         return;
+    StyleTrace::Scope trace("cache", "StyleHelper::drawArrow", -1, 0, StyleTrace::CacheHit);
 
     QRect r = option->rect;
     int size = qMin(r.height(), r.width());
@@ -284,6 +290,7 @@ void StyleHelper::drawArrow(QStyle::PrimitiveElement element, QPainter *painter,
                        uint(option->state), element,
                        size, option->palette.cacheKey());
     if (!QPixmapCache::find(pixmapName, pixmap)) {
+        trace.setCacheResult(StyleTrace::CacheMiss);
         int border = size/5;
         int sqsize = 2*(size/2);
         QImage image(sqsize, sqsize, QImage::Format_ARGB32);
@@ -349,6 +356,7 @@ void StyleHelper::drawArrow(QStyle::PrimitiveElement element, QPainter *painter,
 void StyleHelper::menuGradient(QPainter *painter, const QRect &spanRect, const QRect &clipRect)
 {
     if (StyleHelper::usePixmapCache()) {
+        StyleTrace::Scope trace("cache", "StyleHelper::menuGradient", -1, 0, StyleTrace::CacheHit);
         QString key;
         key.sprintf("mh_menu %d %d %d %d %d",
             spanRect.width(), spanRect.height(), clipRect.width(),
@@ -356,6 +364,7 @@ void StyleHelper::menuGradient(QPainter *painter, const QRect &spanRect, const Q
 
         QPixmap pixmap;
         if (!QPixmapCache::find(key, pixmap)) {
+            trace.setCacheResult(StyleTrace::CacheMiss);
             pixmap = QPixmap(clipRect.size());
             QPainter p(&pixmap);
             QRect rect = QRect(0, 0, clipRect.width(), clipRect.height());
@@ -374,10 +383,12 @@ void StyleHelper::menuGradient(QPainter *painter, const QRect &spanRect, const Q
 void StyleHelper::drawIconWithShadow(const QIcon &icon, const QRect &rect,
                                      QPainter *p, QIcon::Mode iconMode, int radius, const QColor &color, const QPoint &offset)
 {
+    StyleTrace::Scope trace("cache", "StyleHelper::drawIconWithShadow", -1, 0, StyleTrace::CacheHit);
     QPixmap cache;
     QString pixmapName = QString::fromLatin1("icon %0 %1 %2").arg(icon.cacheKey()).arg(iconMode).arg(rect.height());
 
     if (!QPixmapCache::find(pixmapName, cache)) {
+        trace.setCacheResult(StyleTrace::CacheMiss);
         QPixmap px = icon.pixmap(rect.size());
         cache = QPixmap(px.size() + QSize(radius * 2, radius * 2));
         cache.fill(Qt::transparent);
@@ -0,0 +1,14 @@
+# Common settings of the tests, build the library first. Run the tests
+# with QT_QPA_PLATFORM=offscreen.
+
+QT += core gui testlib
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+# The code still used some deprecated stuff
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x040900
+
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+LIBS += -L$$OUT_PWD/.. -lqt-manhattan-style
@@ -0,0 +1,6 @@
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    tst_snapshots.pro \
+    tst_historycompleter.pro \
+    tst_stringutils.pro
@@ -0,0 +1,90 @@
+#include "../historycompleter.h"
+
+#include <QLineEdit>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QtTest>
+
+using namespace Manhattan;
+
+// Measures how long the completer takes to follow typing in a large
+// history. Each iteration types a pattern character by character and
+// clears it again, the time per keystroke is about the result divided by
+// the pattern length.
+
+static const int HISTORY_SIZE = 10000;
+
+class TestHistoryCompleter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void typing_data();
+    void typing();
+
+private:
+    QTemporaryDir m_dir;
+    QSettings *m_settings;
+};
+
+void TestHistoryCompleter::initTestCase()
+{
+    QVERIFY(m_dir.isValid());
+    m_settings = new QSettings(m_dir.path() + QLatin1String("/history.ini"), QSettings::IniFormat);
+
+    QStringList entries;
+    entries.reserve(HISTORY_SIZE);
+    for (int i = 0; i < HISTORY_SIZE; ++i) {
+        entries << QString::fromLatin1("src/module%1/widget%2/file%3.cpp")
+                   .arg(i % 97).arg(i % 13).arg(i);
+    }
+    m_settings->setValue(QLatin1String("CompleterHistory/benchmark"), entries);
+    HistoryCompleter::setSettings(m_settings);
+}
+
+void TestHistoryCompleter::cleanupTestCase()
+{
+    HistoryCompleter::flush();
+    HistoryCompleter::setSettings(0);
+    delete m_settings;
+    m_settings = 0;
+}
+
+void TestHistoryCompleter::typing_data()
+{
+    QTest::addColumn<bool>("fuzzy");
+    QTest::addColumn<QString>("pattern");
+
+    QTest::newRow("prefix") << false << QString::fromLatin1("src/module42/widget7/file");
+    QTest::newRow("prefix-no-match") << false << QString::fromLatin1("include/");
+    QTest::newRow("fuzzy") << true << QString::fromLatin1("m42w7f99");
+    QTest::newRow("fuzzy-no-match") << true << QString::fromLatin1("xyz");
+}
+
+void TestHistoryCompleter::typing()
+{
+    QFETCH(bool, fuzzy);
+    QFETCH(QString, pattern);
+
+    QLineEdit lineEdit;
+    HistoryCompleter *completer = new HistoryCompleter(&lineEdit, QLatin1String("benchmark"), &lineEdit);
+    completer->setFuzzyMatching(fuzzy);
+    completer->setCaseSensitivity(Qt::CaseInsensitive);
+    // Reading the history is not part of the typing
+    completer->setCompletionPrefix(QString());
+    QCOMPARE(completer->completionCount(), HISTORY_SIZE);
+
+    QBENCHMARK {
+        for (int i = 1; i <= pattern.size(); ++i) {
+            completer->setCompletionPrefix(pattern.left(i));
+            completer->completionCount();
+        }
+        completer->setCompletionPrefix(QString());
+    }
+}
+
+QTEST_MAIN(TestHistoryCompleter)
+
+#include "tst_historycompleter.moc"
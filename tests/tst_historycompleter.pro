@@ -0,0 +1,6 @@
+include(tests.pri)
+
+TARGET = tst_historycompleter
+
+SOURCES += \
+    tst_historycompleter.cpp
@@ -0,0 +1,210 @@
+#include "widgetsnapshot.h"
+
+#include "../doubletabwidget.h"
+#include "../fancyactionbar.h"
+#include "../fancytabwidget.h"
+#include "../manhattanstyle.h"
+#include "../progressbar.h"
+#include "../styledbar.h"
+#include "../extensions/tabwidget.h"
+
+#include <QAction>
+#include <QApplication>
+#include <QDir>
+#include <QFile>
+#include <QPainter>
+#include <QStyleOption>
+#include <QtTest>
+
+using namespace Manhattan;
+
+// Renders the widgets of the library at fixed sizes and compares them with
+// the golden images in SNAPSHOT_DIR. Run with SNAPSHOT_UPDATE=1 to record
+// the golden images again after an intended change of the painting.
+// Fonts and antialiasing differ between platforms, the images are meant
+// to be recorded and checked on the "offscreen" platform of one system.
+
+// Largest difference in any channel that still counts as the same pixel
+static const int SNAPSHOT_TOLERANCE = 8;
+
+static QIcon testIcon(const QColor &color)
+{
+    QPixmap pixmap(24, 24);
+    pixmap.fill(color);
+    return QIcon(pixmap);
+}
+
+class TestSnapshots : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void fancyTabBar();
+    void fancyToolButton();
+    void doubleTabWidget();
+    void tabWidget();
+    void progressBar();
+    void styledBar();
+    void primitives_data();
+    void primitives();
+
+private:
+    void compareSnapshot(const QImage &actual, const QString &name);
+};
+
+void TestSnapshots::initTestCase()
+{
+    QApplication::setStyle(new ManhattanStyle(QLatin1String("fusion")));
+    QFont font(QLatin1String("Sans Serif"));
+    font.setPixelSize(12);
+    QApplication::setFont(font);
+}
+
+void TestSnapshots::compareSnapshot(const QImage &actual, const QString &name)
+{
+    const QDir dir(QLatin1String(SNAPSHOT_DIR));
+    const QString fileName = dir.filePath(name + QLatin1String(".png"));
+    if (qgetenv("SNAPSHOT_UPDATE") == "1") {
+        QDir().mkpath(dir.path());
+        QVERIFY2(actual.save(fileName), qPrintable(fileName));
+        return;
+    }
+
+    // Golden images are recorded per reference system, without one there
+    // is nothing to compare with
+    if (!QFile::exists(fileName))
+        QSKIP(qPrintable(QString::fromLatin1("%1 is missing, record it with SNAPSHOT_UPDATE=1").arg(fileName)));
+    const QImage expected(fileName);
+    QVERIFY2(!expected.isNull(), qPrintable(fileName));
+    QImage difference;
+    const int differing = countDifferingPixels(actual, expected, SNAPSHOT_TOLERANCE, &difference);
+    if (differing != 0) {
+        // Keep the output around to look at the differences
+        const QDir temp = QDir::temp();
+        actual.save(temp.filePath(name + QLatin1String("-actual.png")));
+        if (differing > 0)
+            difference.save(temp.filePath(name + QLatin1String("-difference.png")));
+    }
+    QCOMPARE(differing, 0);
+}
+
+void TestSnapshots::fancyTabBar()
+{
+    FancyTabBar bar;
+    bar.insertTab(0, testIcon(Qt::red), QLatin1String("Welcome"));
+    bar.insertTab(1, testIcon(Qt::green), QLatin1String("Edit"));
+    bar.insertTab(2, testIcon(Qt::blue), QLatin1String("Debug"));
+    for (int i = 0; i < bar.count(); ++i)
+        bar.setTabEnabled(i, true);
+    bar.setTabEnabled(2, false);
+    bar.setCurrentIndex(1);
+    compareSnapshot(renderWidgetSnapshot(&bar, QSize(80, 240)), QLatin1String("fancytabbar"));
+}
+
+void TestSnapshots::fancyToolButton()
+{
+    FancyToolButton button;
+    QAction action(testIcon(Qt::darkCyan), QLatin1String("Build"), &button);
+    button.setDefaultAction(&action);
+    compareSnapshot(renderWidgetSnapshot(&button, QSize(80, 60)), QLatin1String("fancytoolbutton"));
+}
+
+void TestSnapshots::doubleTabWidget()
+{
+    DoubleTabWidget widget;
+    widget.setTitle(QLatin1String("Projects"));
+    widget.addTab(QLatin1String("app"), QLatin1String("/src/app"),
+                  QStringList() << QLatin1String("Build") << QLatin1String("Run"));
+    widget.addTab(QLatin1String("lib"), QLatin1String("/src/lib"), QStringList());
+    widget.addTab(QLatin1String("lib"), QLatin1String("/vendor/lib"), QStringList());
+    widget.setCurrentIndex(0);
+    compareSnapshot(renderWidgetSnapshot(&widget, QSize(400, 60)), QLatin1String("doubletabwidget"));
+
+    // Not all tabs fit, the overflow button is shown
+    for (int i = 0; i < 20; ++i)
+        widget.addTab(QString::fromLatin1("tab%1").arg(i), QString(), QStringList());
+    widget.setCurrentIndex(widget.tabCount() - 1);
+    compareSnapshot(renderWidgetSnapshot(&widget, QSize(400, 60)),
+                    QLatin1String("doubletabwidget-overflow"));
+}
+
+void TestSnapshots::tabWidget()
+{
+    TabWidget widget;
+    widget.setTitle(QLatin1String("Output"));
+    widget.addTab(QLatin1String("Compile"), new QWidget);
+    widget.addTab(QLatin1String("Issues"), new QWidget, Qt::darkRed);
+    widget.addTab(QLatin1String("Search"), new QWidget);
+    widget.setCurrentIndex(1);
+    compareSnapshot(renderWidgetSnapshot(&widget, QSize(400, 80)), QLatin1String("tabwidget"));
+
+    widget.setFrameVisible(true);
+    compareSnapshot(renderWidgetSnapshot(&widget, QSize(400, 80)), QLatin1String("tabwidget-frame"));
+}
+
+void TestSnapshots::progressBar()
+{
+    ProgressBar bar;
+    bar.setTitle(QLatin1String("Indexing"));
+    bar.setRange(0, 100);
+    bar.setValue(40);
+    compareSnapshot(renderWidgetSnapshot(&bar, QSize(200, 30)), QLatin1String("progressbar"));
+
+    bar.setError(true);
+    compareSnapshot(renderWidgetSnapshot(&bar, QSize(200, 30)), QLatin1String("progressbar-error"));
+}
+
+void TestSnapshots::styledBar()
+{
+    StyledBar bar;
+    compareSnapshot(renderWidgetSnapshot(&bar, QSize(200, 24)), QLatin1String("styledbar"));
+
+    bar.setLightColored(true);
+    compareSnapshot(renderWidgetSnapshot(&bar, QSize(200, 24)), QLatin1String("styledbar-light"));
+}
+
+void TestSnapshots::primitives_data()
+{
+    QTest::addColumn<int>("element");
+    QTest::addColumn<int>("state");
+
+    QTest::newRow("panelbuttontool") << int(QStyle::PE_PanelButtonTool)
+                                     << int(QStyle::State_Enabled | QStyle::State_Raised);
+    QTest::newRow("panelbuttontool-sunken") << int(QStyle::PE_PanelButtonTool)
+                                            << int(QStyle::State_Enabled | QStyle::State_Sunken);
+    QTest::newRow("panelstatusbar") << int(QStyle::PE_PanelStatusBar) << int(QStyle::State_Enabled);
+    QTest::newRow("toolbarseparator") << int(QStyle::PE_IndicatorToolBarSeparator)
+                                      << int(QStyle::State_Enabled);
+    QTest::newRow("toolbarhandle") << int(QStyle::PE_IndicatorToolBarHandle)
+                                   << int(QStyle::State_Enabled | QStyle::State_Horizontal);
+    QTest::newRow("arrowdown") << int(QStyle::PE_IndicatorArrowDown) << int(QStyle::State_Enabled);
+    QTest::newRow("arrowdown-disabled") << int(QStyle::PE_IndicatorArrowDown) << int(QStyle::State_None);
+}
+
+void TestSnapshots::primitives()
+{
+    QFETCH(int, element);
+    QFETCH(int, state);
+
+    // Only panel widgets get the Manhattan look
+    QWidget panel;
+    panel.setProperty("panelwidget", true);
+    panel.resize(48, 24);
+
+    QStyleOption option;
+    option.initFrom(&panel);
+    option.rect = QRect(0, 0, 48, 24);
+    option.state = QStyle::State(state);
+
+    QImage image(option.rect.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    QApplication::style()->drawPrimitive(QStyle::PrimitiveElement(element), &option, &painter, &panel);
+    painter.end();
+    compareSnapshot(image, QLatin1String("primitive-") + QLatin1String(QTest::currentDataTag()));
+}
+
+QTEST_MAIN(TestSnapshots)
+
+#include "tst_snapshots.moc"
@@ -0,0 +1,12 @@
+include(tests.pri)
+
+DEFINES += SNAPSHOT_DIR=\\\"$$PWD/snapshots\\\"
+
+TARGET = tst_snapshots
+
+SOURCES += \
+    tst_snapshots.cpp \
+    widgetsnapshot.cpp
+
+HEADERS += \
+    widgetsnapshot.h
@@ -0,0 +1,173 @@
+#include "../stringutils.h"
+
+#include <QStringList>
+#include <QtTest>
+
+using namespace Manhattan;
+
+// Checks commonPrefixLength() against a plain loop, which is also what it
+// does without SSE2, and measures both over many similar paths. Checks
+// that MacroTemplate expands like expandMacros().
+
+// The loop commonPrefixLength() uses without SSE2 and for the last block
+static int scalarCommonPrefixLength(const QString &s1, const QString &s2, int maxLength)
+{
+    const int size = qMin(maxLength, qMin(s1.size(), s2.size()));
+    for (int i = 0; i < size; i++)
+        if (s1.at(i) != s2.at(i))
+            return i;
+    return size;
+}
+
+static QStringList createPaths(int count)
+{
+    QStringList paths;
+    paths.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        paths << QString::fromLatin1("/home/user/projects/manhattan/src/module%1/widget%2/file%3.cpp")
+                 .arg(i / 1000).arg(i / 100 % 10).arg(i);
+    }
+    return paths;
+}
+
+// Resolves "a", "b" and the empty name, the values contain macro syntax
+// that must not be expanded again
+class TestMacroExpander : public AbstractQtcMacroExpander
+{
+public:
+    bool resolveMacro(const QString &name, QString *ret)
+    {
+        if (name == QLatin1String("a"))
+            *ret = QLatin1String("A");
+        else if (name == QLatin1String("b"))
+            *ret = QLatin1String("%{a}");
+        else if (name.isEmpty())
+            *ret = QLatin1String("%");
+        else
+            return false;
+        return true;
+    }
+};
+
+class TestStringUtils : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void commonPrefixLength_data();
+    void commonPrefixLength();
+    void commonPrefixLengthBenchmark_data();
+    void commonPrefixLengthBenchmark();
+    void macroTemplate_data();
+    void macroTemplate();
+};
+
+void TestStringUtils::commonPrefixLength_data()
+{
+    QTest::addColumn<QString>("s1");
+    QTest::addColumn<QString>("s2");
+    QTest::addColumn<int>("maxLength");
+
+    QTest::newRow("empty") << QString() << QString() << 0;
+    QTest::newRow("one-empty") << QString::fromLatin1("abc") << QString() << 3;
+    QTest::newRow("equal") << QString::fromLatin1("C:\\foo\\bar") << QString::fromLatin1("C:\\foo\\bar") << 10;
+    QTest::newRow("case") << QString::fromLatin1("C:\\a") << QString::fromLatin1("c:\\b") << 4;
+    QTest::newRow("max-length") << QString::fromLatin1("abcdefghijkl") << QString::fromLatin1("abcdefghijkl") << 5;
+    QTest::newRow("non-latin") << QString::fromUtf8("/home/\xc3\xa9t\xc3\xa9/a") << QString::fromUtf8("/home/\xc3\xa9t\xc3\xa9/b") << 20;
+
+    // Lengths around and between blocks of 8, with the mismatch at every
+    // position and without one
+    const QString base = QString::fromLatin1("/usr/local/include/manhattan/");
+    for (int length = 1; length <= base.size(); ++length) {
+        const QString s1 = base.left(length);
+        QTest::newRow(qPrintable(QString::fromLatin1("length%1-same").arg(length)))
+                << s1 << s1 + QLatin1Char('x') << length + 1;
+        for (int mismatch = 0; mismatch < length; ++mismatch) {
+            QString s2 = s1;
+            s2[mismatch] = QLatin1Char('#');
+            QTest::newRow(qPrintable(QString::fromLatin1("length%1-at%2").arg(length).arg(mismatch)))
+                    << s1 << s2 << length;
+        }
+    }
+}
+
+void TestStringUtils::commonPrefixLength()
+{
+    QFETCH(QString, s1);
+    QFETCH(QString, s2);
+    QFETCH(int, maxLength);
+
+    const int expected = scalarCommonPrefixLength(s1, s2, maxLength);
+    QCOMPARE(Manhattan::commonPrefixLength(s1, s2, maxLength), expected);
+    QCOMPARE(Manhattan::commonPrefixLength(s2, s1, maxLength), expected);
+}
+
+void TestStringUtils::commonPrefixLengthBenchmark_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("scalar");
+
+    QTest::newRow("10k-scalar") << 10000 << true;
+    QTest::newRow("10k") << 10000 << false;
+    QTest::newRow("100k-scalar") << 100000 << true;
+    QTest::newRow("100k") << 100000 << false;
+}
+
+// Compares each path with the one before, like sorting or grouping them
+void TestStringUtils::commonPrefixLengthBenchmark()
+{
+    QFETCH(int, count);
+    QFETCH(bool, scalar);
+
+    const QStringList paths = createPaths(count);
+    int total = 0;
+    QBENCHMARK {
+        total = 0;
+        for (int i = 1; i < paths.size(); ++i) {
+            const QString &s1 = paths.at(i - 1);
+            const QString &s2 = paths.at(i);
+            total += scalar ? scalarCommonPrefixLength(s1, s2, s1.size())
+                            : Manhattan::commonPrefixLength(s1, s2, s1.size());
+        }
+    }
+    QVERIFY(total > 0);
+}
+
+void TestStringUtils::macroTemplate_data()
+{
+    QTest::addColumn<QString>("source");
+    QTest::addColumn<QString>("expected");
+
+    QTest::newRow("empty") << QString() << QString();
+    QTest::newRow("no-macros") << QString::fromLatin1("plain text") << QString::fromLatin1("plain text");
+    QTest::newRow("macro") << QString::fromLatin1("x%{a}y") << QString::fromLatin1("xAy");
+    QTest::newRow("unknown") << QString::fromLatin1("x%{unknown}y") << QString::fromLatin1("x%{unknown}y");
+    QTest::newRow("unknown-and-known") << QString::fromLatin1("%{c}%{a}") << QString::fromLatin1("%{c}A");
+    QTest::newRow("percent") << QString::fromLatin1("100%% %{a}%%") << QString::fromLatin1("100%% A%%");
+    QTest::newRow("percent-brace") << QString::fromLatin1("%%{a}") << QString::fromLatin1("%A");
+    QTest::newRow("unterminated") << QString::fromLatin1("x%{a") << QString::fromLatin1("x%{a");
+    QTest::newRow("unterminated-after") << QString::fromLatin1("%{a}%{a") << QString::fromLatin1("A%{a");
+    QTest::newRow("adjacent") << QString::fromLatin1("%{a}%{a}%{a}") << QString::fromLatin1("AAA");
+    QTest::newRow("adjacent-unknown") << QString::fromLatin1("%{c}%{a}%{d}") << QString::fromLatin1("%{c}A%{d}");
+    QTest::newRow("not-expanded-again") << QString::fromLatin1("%{b}") << QString::fromLatin1("%{a}");
+    QTest::newRow("empty-name") << QString::fromLatin1("%{}{a}") << QString::fromLatin1("%{a}");
+    QTest::newRow("nested") << QString::fromLatin1("%{x%{a}}") << QString::fromLatin1("%{xA}");
+}
+
+void TestStringUtils::macroTemplate()
+{
+    QFETCH(QString, source);
+    QFETCH(QString, expected);
+
+    TestMacroExpander expander;
+    QCOMPARE(expandMacros(source, &expander), expected);
+    const MacroTemplate macroTemplate(source);
+    QCOMPARE(macroTemplate.source(), source);
+    QCOMPARE(macroTemplate.expand(&expander), expected);
+    // The template can be expanded again
+    QCOMPARE(macroTemplate.expand(&expander), expected);
+}
+
+QTEST_APPLESS_MAIN(TestStringUtils)
+
+#include "tst_stringutils.moc"
@@ -0,0 +1,6 @@
+include(tests.pri)
+
+TARGET = tst_stringutils
+
+SOURCES += \
+    tst_stringutils.cpp
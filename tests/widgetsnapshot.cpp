@@ -0,0 +1,58 @@
+#include "widgetsnapshot.h"
+
+#include <QLayout>
+#include <QPainter>
+#include <QWidget>
+
+namespace Manhattan {
+
+QImage renderWidgetSnapshot(QWidget *widget, const QSize &size)
+{
+    widget->ensurePolished();
+    widget->resize(size);
+    if (widget->layout())
+        widget->layout()->activate();
+
+    QImage image(size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    widget->render(&image);
+    return image;
+}
+
+int countDifferingPixels(const QImage &actual, const QImage &expected,
+                         int tolerance, QImage *difference)
+{
+    if (actual.size() != expected.size())
+        return -1;
+    // Compare the same format, whatever the images were loaded as
+    const QImage a = actual.convertToFormat(QImage::Format_ARGB32);
+    const QImage b = expected.convertToFormat(QImage::Format_ARGB32);
+    if (difference) {
+        *difference = QImage(a.size(), QImage::Format_ARGB32);
+        difference->fill(Qt::transparent);
+    }
+
+    int count = 0;
+    for (int y = 0; y < a.height(); ++y) {
+        const QRgb *lineA = reinterpret_cast<const QRgb *>(a.constScanLine(y));
+        const QRgb *lineB = reinterpret_cast<const QRgb *>(b.constScanLine(y));
+        for (int x = 0; x < a.width(); ++x) {
+            const QRgb pa = lineA[x];
+            const QRgb pb = lineB[x];
+            if (pa == pb)
+                continue;
+            if (qAbs(qRed(pa) - qRed(pb)) <= tolerance
+                    && qAbs(qGreen(pa) - qGreen(pb)) <= tolerance
+                    && qAbs(qBlue(pa) - qBlue(pb)) <= tolerance
+                    && qAbs(qAlpha(pa) - qAlpha(pb)) <= tolerance) {
+                continue;
+            }
+            ++count;
+            if (difference)
+                difference->setPixel(x, y, qRgb(255, 0, 0));
+        }
+    }
+    return count;
+}
+
+} // namespace Manhattan
@@ -0,0 +1,28 @@
+#ifndef WIDGETSNAPSHOT_H
+#define WIDGETSNAPSHOT_H
+
+#include <QImage>
+
+QT_BEGIN_NAMESPACE
+class QWidget;
+QT_END_NAMESPACE
+
+namespace Manhattan {
+
+// Helpers to check that changes to painting code keep the output the same:
+// render a widget offscreen before and after, and compare the images.
+// Rendering does not need the widget to be shown, so this also works on
+// the "offscreen" platform plugin without a display.
+
+// Renders widget resized to size into an ARGB32 premultiplied image
+QImage renderWidgetSnapshot(QWidget *widget, const QSize &size);
+
+// Returns how many pixels differ by more than tolerance in any channel,
+// or -1 when the sizes differ. If difference is given, it is set to an
+// image marking the differing pixels.
+int countDifferingPixels(const QImage &actual, const QImage &expected,
+                         int tolerance = 0, QImage *difference = 0);
+
+} // namespace Manhattan
+
+#endif // WIDGETSNAPSHOT_H